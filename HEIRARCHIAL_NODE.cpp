@@ -1,137 +1,602 @@
 #include "HIERARCHIAL.h"
 #include "shape.h" // Include shape header for derived types in load()
+#include "model_binary.h"
+#include "task_pool.h"
 #include <fstream>
-#include <sstream>
-#include <unordered_map>
+#include <algorithm>
+#include <functional>
 #include <iostream>
 
 
-model_node_t::model_node_t(std::shared_ptr<shape_t> s, ShapeType t)
-    : id(next_id++), shape(std::move(s)), type(t) {}
+// The rotation matrix comes straight from the quaternion, its columns scaled
+// by the scale, with the translation as the last column: one straight-line
+// pass with no matrix products, which the compiler keeps in vector registers
+glm::mat4 model_node_t::getTransform() const {
+    const glm::quat& q = rotation;
+    float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+    float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+    float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+    return glm::mat4(
+        glm::vec4(1.0f - 2.0f * (yy + zz), 2.0f * (xy + wz), 2.0f * (xz - wy), 0.0f) * scale.x,
+        glm::vec4(2.0f * (xy - wz), 1.0f - 2.0f * (xx + zz), 2.0f * (yz + wx), 0.0f) * scale.y,
+        glm::vec4(2.0f * (xz + wy), 2.0f * (yz - wx), 1.0f - 2.0f * (xx + yy), 0.0f) * scale.z,
+        glm::vec4(translation, 1.0f));
+}
 
-void model_node_t::addChild(const std::shared_ptr<model_node_t>& child) {
-    child->parent = shared_from_this();
-    children.push_back(child);
+// Renormalizing after every step keeps repeated small turns from drifting
+void model_node_t::rotate(float angle, const glm::vec3& axis) {
+    rotation = glm::normalize(rotation * glm::angleAxis(angle, axis));
 }
 
-glm::mat4 model_node_t::getTransform() const {
-    return translation * rotation * scale;
+glm::vec3 translationFromMatrix(const float* m) {
+    return glm::vec3(m[12], m[13], m[14]);
+}
+
+glm::quat rotationFromMatrix(const float* m) {
+    return glm::normalize(glm::quat_cast(glm::mat3(glm::make_mat4(m))));
+}
+
+glm::vec3 scaleFromMatrix(const float* m) {
+    return glm::vec3(m[0], m[5], m[10]);
 }
 
 // model_t Method Definitions
 
 model_t::model_t() {
     // Create a single root node for the scene
-    root_node = std::make_shared<model_node_t>(nullptr, SPHERE_SHAPE); // Placeholder type
-    root_node->id = next_id++;
-    shapes.push_back(root_node);
+    clear();
 }
 
-std::shared_ptr<model_node_t> model_t::findMNodeById(int id) {
-    for (auto &m : shapes) if (m->id == id) return m;
-    return nullptr;
+node_handle_t model_t::createNode(std::unique_ptr<shape_t> shape, uint32_t parent, int id) {
+    uint32_t slot;
+    if (!free_slots.empty()) {
+        slot = free_slots.back();
+        free_slots.pop_back();
+    } else {
+        slot = static_cast<uint32_t>(slots.size());
+        slots.push_back({NO_NODE, 0});
+    }
+
+    uint32_t index = static_cast<uint32_t>(nodes.size());
+    slots[slot].index = index;
+    nodes.emplace_back();
+    model_node_t& node = nodes.back();
+    node.id = id;
+    if (id >= next_id) next_id = id + 1;
+    node.type = shape ? shape->shapetype : SPHERE_SHAPE; // Placeholder type for the root
+    node.shape = std::move(shape);
+    node.slot = slot;
+    node.parent = parent;
+    node.subtreeEnd = index + 1;
+
+    if (parent != NO_NODE) {
+        model_node_t& p = nodes[parent];
+        node.prevSibling = p.lastChild;
+        if (p.lastChild == NO_NODE) p.firstChild = index;
+        else nodes[p.lastChild].nextSibling = index;
+        p.lastChild = index;
+        // The new node sits at the end of the pool, outside its parent's range
+        layout_dirty = true;
+    }
+
+    ++live_count;
+    node_handle_t h{slot, slots[slot].generation};
+    id_index[id] = h;
+    added.push_back(h);
+    dirty_roots.push_back(h);
+    ++revision;
+    return h;
 }
 
-std::shared_ptr<model_node_t> model_t::getRoot() {
-    return root_node;
+uint32_t model_t::indexOf(node_handle_t h) const {
+    if (h.slot >= slots.size() || slots[h.slot].generation != h.generation) return NO_NODE;
+    return slots[h.slot].index;
 }
 
-const std::vector<std::shared_ptr<model_node_t>>& model_t::getShapes() const { return shapes; }
+node_handle_t model_t::handleOf(uint32_t index) const {
+    if (index >= nodes.size() || nodes[index].slot == NO_NODE) return {};
+    uint32_t slot = nodes[index].slot;
+    return {slot, slots[slot].generation};
+}
 
-void model_t::addShape(std::unique_ptr<shape_t> shape) {
-    addShapeToParent(getRoot()->id, std::move(shape));
+model_node_t* model_t::getNode(node_handle_t h) {
+    uint32_t index = indexOf(h);
+    return index == NO_NODE ? nullptr : &nodes[index];
 }
 
-void model_t::addShapeToParent(int parent_ui_id, std::unique_ptr<shape_t> shape) {
-    std::shared_ptr<model_node_t> parent_node = findMNodeById(parent_ui_id);
-    if (!parent_node) {
-        parent_node = getRoot();
-        if (!parent_node) return;
+const model_node_t* model_t::getNode(node_handle_t h) const {
+    uint32_t index = indexOf(h);
+    return index == NO_NODE ? nullptr : &nodes[index];
+}
+
+node_handle_t model_t::getParent(node_handle_t h) const {
+    const model_node_t* node = getNode(h);
+    return node ? handleOf(node->parent) : node_handle_t{};
+}
+
+node_handle_t model_t::getFirstChild(node_handle_t h) const {
+    const model_node_t* node = getNode(h);
+    return node ? handleOf(node->firstChild) : node_handle_t{};
+}
+
+node_handle_t model_t::findMNodeById(int id) const {
+    auto it = id_index.find(id);
+    return it == id_index.end() ? node_handle_t{} : it->second;
+}
+
+node_handle_t model_t::getRoot() const {
+    return handleOf(0);
+}
+
+const std::vector<model_node_t>& model_t::getNodes() {
+    ensureLayout();
+    return nodes;
+}
+
+void model_t::ensureLayout() {
+    if (layout_dirty) relayout();
+}
+
+void model_t::relayout() {
+    // Preorder walk from the root; removed nodes are unreachable and drop out
+    std::vector<model_node_t> sorted;
+    sorted.reserve(live_count);
+    std::vector<uint32_t> new_index(nodes.size(), NO_NODE);
+    std::vector<uint32_t> stack{0};
+    while (!stack.empty()) {
+        uint32_t i = stack.back();
+        stack.pop_back();
+        new_index[i] = static_cast<uint32_t>(sorted.size());
+        sorted.push_back(std::move(nodes[i]));
+
+        // Push the children in reverse so the first child is visited first
+        size_t mark = stack.size();
+        for (uint32_t c = sorted.back().firstChild; c != NO_NODE; c = nodes[c].nextSibling) {
+            stack.push_back(c);
+        }
+        std::reverse(stack.begin() + mark, stack.end());
     }
 
-    // Convert unique_ptr to shared_ptr and create the node
-    std::shared_ptr<shape_t> shared_shape(std::move(shape));
-    auto new_node = std::make_shared<model_node_t>(shared_shape, shared_shape ? shared_shape->shapetype : SPHERE_SHAPE);
-    
-    if (shared_shape && !shared_shape->colors.empty()) {
-        new_node->color = shared_shape->colors[0];
+    auto remap = [&](uint32_t i) { return i == NO_NODE ? NO_NODE : new_index[i]; };
+    for (uint32_t i = 0; i < sorted.size(); ++i) {
+        model_node_t& node = sorted[i];
+        node.parent = remap(node.parent);
+        node.firstChild = remap(node.firstChild);
+        node.lastChild = remap(node.lastChild);
+        node.prevSibling = remap(node.prevSibling);
+        node.nextSibling = remap(node.nextSibling);
+        node.subtreeEnd = i + 1;
+        slots[node.slot].index = i;
     }
-    
-    parent_node->addChild(new_node);
-    shapes.push_back(new_node);
+    // Children come after their parent, so one backward pass sizes every subtree
+    for (uint32_t i = static_cast<uint32_t>(sorted.size()); i-- > 1;) {
+        model_node_t& parent = sorted[sorted[i].parent];
+        if (parent.subtreeEnd < sorted[i].subtreeEnd) parent.subtreeEnd = sorted[i].subtreeEnd;
+    }
+
+    nodes.swap(sorted);
+    layout_dirty = false;
+    segments_valid = false;
+}
+
+void model_t::addShape(std::unique_ptr<shape_t> shape) {
+    addShapeToParent(nodes[0].id, std::move(shape));
+}
+
+void model_t::addShapeToParent(int parent_ui_id, std::unique_ptr<shape_t> shape) {
+    uint32_t parent = indexOf(findMNodeById(parent_ui_id));
+    if (parent == NO_NODE) parent = 0; // fall back to the root
+
+    glm::vec4 color = shape ? shape->color : glm::vec4(1.0f);
+
+    node_handle_t h = createNode(std::move(shape), parent, next_id);
+    getNode(h)->color = color;
 }
 
 void model_t::removeLastShape() {
-    if (shapes.size() <= 1) return; // Can't remove the root
+    if (live_count <= 1) return; // Can't remove the root
     
-    auto last_node = shapes.back();
-    shapes.pop_back();
-
-    if (auto parent_node = last_node->parent.lock()) {
-        auto& children = parent_node->children;
-        for (auto it = children.begin(); it != children.end(); ++it) {
-            if ((*it)->id == last_node->id) {
-                children.erase(it);
-                break;
-            }
+    // The most recently added node is a leaf: children are always added
+    // after their parent
+    removeSubtree(getNode(getLastNode())->id);
+}
+
+void model_t::unlink(uint32_t index) {
+    model_node_t& node = nodes[index];
+    model_node_t& parent = nodes[node.parent];
+    if (node.prevSibling == NO_NODE) parent.firstChild = node.nextSibling;
+    else nodes[node.prevSibling].nextSibling = node.nextSibling;
+    if (node.nextSibling == NO_NODE) parent.lastChild = node.prevSibling;
+    else nodes[node.nextSibling].prevSibling = node.prevSibling;
+    node.parent = node.prevSibling = node.nextSibling = NO_NODE;
+}
+
+void model_t::freeNode(uint32_t index) {
+    model_node_t& node = nodes[index];
+    id_index.erase(node.id);
+    slots[node.slot].index = NO_NODE;
+    slots[node.slot].generation++;
+    free_slots.push_back(node.slot);
+    node.slot = NO_NODE;
+    node.shape.reset();
+    --live_count;
+    // The hole in the pool is squeezed out on the next relayout
+    layout_dirty = true;
+}
+
+bool model_t::removeNode(int id) {
+    uint32_t index = indexOf(findMNodeById(id));
+    if (index == NO_NODE || index == 0) return false;
+
+    model_node_t& node = nodes[index];
+    uint32_t first = node.firstChild;
+    // The parent's bounds shrink on the next updateTransforms()
+    dirty_roots.push_back(handleOf(node.parent));
+    if (first == NO_NODE) {
+        unlink(index);
+    } else {
+        // Splice the children into the parent's list where the node was
+        uint32_t last = node.lastChild;
+        uint32_t parent = node.parent;
+        for (uint32_t c = first; c != NO_NODE; c = nodes[c].nextSibling) {
+            nodes[c].parent = parent;
+            dirty_roots.push_back(handleOf(c));
+        }
+        nodes[first].prevSibling = node.prevSibling;
+        nodes[last].nextSibling = node.nextSibling;
+        if (node.prevSibling == NO_NODE) nodes[parent].firstChild = first;
+        else nodes[node.prevSibling].nextSibling = first;
+        if (node.nextSibling == NO_NODE) nodes[parent].lastChild = last;
+        else nodes[node.nextSibling].prevSibling = last;
+    }
+    freeNode(index);
+    ++revision;
+    return true;
+}
+
+bool model_t::removeSubtree(int id) {
+    uint32_t index = indexOf(findMNodeById(id));
+    if (index == NO_NODE || index == 0) return false;
+
+    dirty_roots.push_back(handleOf(nodes[index].parent));
+    unlink(index);
+    std::vector<uint32_t> stack{index};
+    while (!stack.empty()) {
+        uint32_t i = stack.back();
+        stack.pop_back();
+        for (uint32_t c = nodes[i].firstChild; c != NO_NODE; c = nodes[c].nextSibling) {
+            stack.push_back(c);
         }
+        freeNode(i);
     }
+    ++revision;
+    return true;
 }
 
-std::shared_ptr<model_node_t> model_t::getCurrentShape() {
-    if (shapes.size() <= 1) return getRoot();
-    return shapes.back();
+node_handle_t model_t::getCurrentShape() {
+    if (live_count <= 1) return getRoot();
+    return getLastNode();
 }
 
-std::shared_ptr<model_node_t> model_t::getLastNode() {
-    if (shapes.empty()) return nullptr;
-    return shapes.back();
+node_handle_t model_t::getLastNode() {
+    while (!added.empty() && indexOf(added.back()) == NO_NODE) added.pop_back();
+    if (added.empty()) return {};
+    return added.back();
 }
 
 void model_t::rotateModel(char axis, bool positive) {
     float ang = glm::radians(5.0f) * (positive ? 1.0f : -1.0f);
-    if (axis == 'X') root_node->rotation = glm::rotate(root_node->rotation, ang, glm::vec3(1,0,0));
-    else if (axis == 'Y') root_node->rotation = glm::rotate(root_node->rotation, ang, glm::vec3(0,1,0));
-    else if (axis == 'Z') root_node->rotation = glm::rotate(root_node->rotation, ang, glm::vec3(0,0,1));
+    model_node_t& root_node = nodes[0];
+    if (axis == 'X') root_node.rotate(ang, glm::vec3(1,0,0));
+    else if (axis == 'Y') root_node.rotate(ang, glm::vec3(0,1,0));
+    else if (axis == 'Z') root_node.rotate(ang, glm::vec3(0,0,1));
+    markDirty(getRoot());
+}
+
+void model_t::markDirty(node_handle_t h) {
+    model_node_t* node = getNode(h);
+    if (!node) return;
+    node->localDirty = true;
+    dirty_roots.push_back(h);
+    ++revision;
+}
+
+void model_t::updateTransforms(const glm::mat4& rootTransform, const glm::mat4& viewProjection) {
+    ensureLayout();
+
+    bool rootChanged = !transformsValid || rootTransform != lastRootTransform;
+    bool viewChanged = !transformsValid || viewProjection != lastViewProjection;
+    lastRootTransform = rootTransform;
+    lastViewProjection = viewProjection;
+    transformsValid = true;
+
+    if (rootChanged) {
+        dirty_roots.clear();
+        dirty_roots.push_back(getRoot());
+    }
+
+    if (!dirty_roots.empty()) {
+        // Each dirty subtree is a contiguous range of the pool. Sorted by
+        // start, an ancestor's range comes first and covers its descendants'.
+        std::vector<uint32_t> starts;
+        starts.reserve(dirty_roots.size());
+        for (node_handle_t h : dirty_roots) {
+            uint32_t index = indexOf(h);
+            if (index != NO_NODE) starts.push_back(index);
+        }
+        std::sort(starts.begin(), starts.end());
+
+        uint32_t covered = 0;
+        for (uint32_t start : starts) {
+            if (start < covered) continue;
+            updateSubtree(start, rootTransform, viewProjection);
+            covered = nodes[start].subtreeEnd;
+        }
+
+        // Ancestors of the refreshed ranges, deepest (highest index) first so
+        // every child is final before its parent folds it in
+        std::vector<uint32_t> ancestors;
+        covered = 0;
+        for (uint32_t start : starts) {
+            if (start < covered) continue;
+            for (uint32_t p = nodes[start].parent; p != NO_NODE; p = nodes[p].parent) ancestors.push_back(p);
+            covered = nodes[start].subtreeEnd;
+        }
+        std::sort(ancestors.begin(), ancestors.end(), std::greater<uint32_t>());
+        ancestors.erase(std::unique(ancestors.begin(), ancestors.end()), ancestors.end());
+        for (uint32_t p : ancestors) refreshSubtreeBounds(p);
+
+        dirty_roots.clear();
+    }
+
+    if (viewChanged) {
+        size_t blocks = (nodes.size() + SCENE_TASK_NODES - 1) / SCENE_TASK_NODES;
+        task_pool_t::instance().run(blocks, [&](size_t b) {
+            size_t end = std::min(nodes.size(), (b + 1) * SCENE_TASK_NODES);
+            for (size_t i = b * SCENE_TASK_NODES; i < end; ++i) nodes[i].mvpMatrix = viewProjection * nodes[i].worldMatrix;
+        });
+    }
+}
+
+void model_t::updateMatrices(uint32_t start, uint32_t end, const glm::mat4& rootTransform,
+                             const glm::mat4& viewProjection) {
+    for (uint32_t i = start; i < end; ++i) {
+        model_node_t& node = nodes[i];
+        if (node.localDirty) {
+            node.localMatrix = node.getTransform();
+            node.localDirty = false;
+        }
+        const glm::mat4& parentWorld = node.parent == NO_NODE ? rootTransform : nodes[node.parent].worldMatrix;
+        node.worldMatrix = parentWorld * node.localMatrix;
+        node.mvpMatrix = viewProjection * node.worldMatrix;
+    }
+}
+
+// Matrices and bounds of the subtree at start. Small subtrees, or any subtree
+// when there are no workers, take one pass on this thread.
+void model_t::updateSubtree(uint32_t start, const glm::mat4& rootTransform, const glm::mat4& viewProjection) {
+    uint32_t end = nodes[start].subtreeEnd;
+    task_pool_t& pool = task_pool_t::instance();
+    if (end - start <= 2 * SCENE_TASK_NODES || pool.threadCount() == 1) {
+        updateMatrices(start, end, rootTransform, viewProjection);
+        refreshBounds(start, end);
+        return;
+    }
+
+    const std::vector<segment_t>* segments = &subtree_segments;
+    if (start == 0) segments = &rootSegments();
+    else splitSubtrees(start, subtree_segments);
+
+    // Spine matrices top-down, so every task finds its parent's world matrix
+    for (const segment_t& s : *segments) {
+        if (s.spine) updateMatrices(s.start, s.end, rootTransform, viewProjection);
+    }
+    pool.run(segments->size(), [&](size_t k) {
+        const segment_t& s = (*segments)[k];
+        if (s.spine) return;
+        updateMatrices(s.start, s.end, rootTransform, viewProjection);
+        refreshBounds(s.start, s.end);
+    });
+    // Spine bounds bottom-up, once everything below them is final
+    for (size_t k = segments->size(); k-- > 0;) {
+        const segment_t& s = (*segments)[k];
+        if (s.spine) refreshBounds(s.start, s.end);
+    }
+}
+
+const std::vector<model_t::segment_t>& model_t::rootSegments() {
+    if (!segments_valid) {
+        splitSubtrees(0, root_segments);
+        segments_valid = true;
+    }
+    return root_segments;
+}
+
+// Cuts the subtree at top into segments, in pool order. A node with more
+// than SCENE_TASK_NODES nodes below it becomes a spine segment and its
+// children are cut in turn; runs of smaller sibling subtrees are gathered
+// until they reach SCENE_TASK_NODES.
+void model_t::splitSubtrees(uint32_t top, std::vector<segment_t>& out) const {
+    out.clear();
+    // Work still to emit, last first: spine candidates and finished runs
+    std::vector<segment_t> stack{{top, nodes[top].subtreeEnd, NO_NODE, true}};
+    std::vector<segment_t> children;
+    while (!stack.empty()) {
+        segment_t s = stack.back();
+        stack.pop_back();
+        if (!s.spine || s.end - s.start <= SCENE_TASK_NODES) {
+            s.spine = false;
+            out.push_back(s);
+            continue;
+        }
+
+        uint32_t self = static_cast<uint32_t>(out.size());
+        out.push_back({s.start, s.start + 1, s.parent, true});
+        children.clear();
+        uint32_t runStart = NO_NODE, runEnd = 0;
+        for (uint32_t c = nodes[s.start].firstChild; c != NO_NODE; c = nodes[c].nextSibling) {
+            uint32_t size = nodes[c].subtreeEnd - c;
+            if (size > SCENE_TASK_NODES) {
+                if (runStart != NO_NODE) children.push_back({runStart, runEnd, self, false});
+                runStart = NO_NODE;
+                children.push_back({c, nodes[c].subtreeEnd, self, true});
+                continue;
+            }
+            // Siblings are adjacent in pool order, so a run is one range
+            if (runStart == NO_NODE) runStart = c;
+            runEnd = nodes[c].subtreeEnd;
+            if (runEnd - runStart >= SCENE_TASK_NODES) {
+                children.push_back({runStart, runEnd, self, false});
+                runStart = NO_NODE;
+            }
+        }
+        if (runStart != NO_NODE) children.push_back({runStart, runEnd, self, false});
+        stack.insert(stack.end(), children.rbegin(), children.rend());
+    }
+}
+
+namespace {
+
+// Walks [start, end) using each node's subtree bounds as a bounding volume
+// hierarchy: a subtree entirely outside the frustum is skipped in one step,
+// and one entirely inside is accepted without testing its nodes. Nodes
+// before insideEnd are in a subtree that was accepted already.
+void cullRange(const std::vector<model_node_t>& nodes, const frustum_t& frustum, uint32_t start, uint32_t end,
+               uint32_t insideEnd, std::vector<const model_node_t*>& out) {
+    for (uint32_t i = start; i < end;) {
+        const model_node_t& node = nodes[i];
+        if (i >= insideEnd) {
+            frustum_t::result_t result = frustum.classify(node.subtreeBounds);
+            if (result == frustum_t::OUTSIDE) {
+                i = node.subtreeEnd;
+                continue;
+            }
+            if (result == frustum_t::INSIDE) {
+                insideEnd = node.subtreeEnd;
+            } else if (frustum.classify(node.worldBounds) == frustum_t::OUTSIDE) {
+                ++i;
+                continue;
+            }
+        }
+        if (node.shape) out.push_back(&node);
+        ++i;
+    }
+}
+
+} // namespace
+
+void model_t::collectVisible(const glm::mat4& viewProjection, bool cull, std::vector<const model_node_t*>& out) {
+    ensureLayout();
+    out.clear();
+    frustum_t frustum(viewProjection);
+    uint32_t count = static_cast<uint32_t>(nodes.size());
+    task_pool_t& pool = task_pool_t::instance();
+    if (count <= 2 * SCENE_TASK_NODES || pool.threadCount() == 1) {
+        cullRange(nodes, frustum, 0, count, cull ? 0 : count, out);
+        return;
+    }
+
+    // Spine nodes top-down, each classified after its parent; a task starts
+    // from the result of the spine node above it
+    const std::vector<segment_t>& segments = rootSegments();
+    frustum_t::result_t top = cull ? frustum_t::INTERSECTS : frustum_t::INSIDE;
+    std::vector<frustum_t::result_t> results(segments.size(), top);
+    segment_visible.resize(segments.size());
+    for (size_t k = 0; k < segments.size(); ++k) {
+        const segment_t& s = segments[k];
+        segment_visible[k].clear();
+        if (!s.spine) continue;
+        const model_node_t& node = nodes[s.start];
+        frustum_t::result_t above = s.parent == NO_NODE ? top : results[s.parent];
+        results[k] = above == frustum_t::INTERSECTS ? frustum.classify(node.subtreeBounds) : above;
+        bool visible = results[k] == frustum_t::INSIDE ||
+                       (results[k] == frustum_t::INTERSECTS && frustum.classify(node.worldBounds) != frustum_t::OUTSIDE);
+        if (visible && node.shape) segment_visible[k].push_back(&node);
+    }
+    pool.run(segments.size(), [&](size_t k) {
+        const segment_t& s = segments[k];
+        if (s.spine) return;
+        frustum_t::result_t above = s.parent == NO_NODE ? top : results[s.parent];
+        if (above == frustum_t::OUTSIDE) return;
+        cullRange(nodes, frustum, s.start, s.end, above == frustum_t::INSIDE ? s.end : s.start, segment_visible[k]);
+    });
+
+    size_t total = 0;
+    for (const auto& part : segment_visible) total += part.size();
+    out.reserve(total);
+    for (const auto& part : segment_visible) out.insert(out.end(), part.begin(), part.end());
+}
+
+// World bounds of the freshly transformed range [start, end). Walking it
+// backwards visits children before their parents.
+void model_t::refreshBounds(uint32_t start, uint32_t end) {
+    for (uint32_t i = end; i-- > start;) {
+        model_node_t& node = nodes[i];
+        if (node.shape && node.shape->mesh) node.worldBounds = node.shape->mesh->bounds.transformed(node.worldMatrix);
+        else node.worldBounds = aabb_t{};
+        refreshSubtreeBounds(i);
+    }
+}
+
+void model_t::refreshSubtreeBounds(uint32_t index) {
+    model_node_t& node = nodes[index];
+    node.subtreeBounds = node.worldBounds;
+    for (uint32_t c = node.firstChild; c != NO_NODE; c = nodes[c].nextSibling) {
+        node.subtreeBounds.expand(nodes[c].subtreeBounds);
+    }
 }
 
 size_t model_t::getShapeCount() const {
-    return (shapes.size() <= 1) ? 0 : shapes.size() - 1;
+    return (live_count <= 1) ? 0 : live_count - 1;
 }
 
 void model_t::clear() {
-    shapes.clear();
-    root_node = std::make_shared<model_node_t>(nullptr, SPHERE_SHAPE);
-    root_node->id = next_id++;
-    shapes.push_back(root_node);
+    // The whole pool goes at once. Slots are kept with bumped generations so
+    // handles into the old model can never resolve to nodes of the new one.
+    nodes.clear();
+    added.clear();
+    id_index.clear();
+    dirty_roots.clear();
+    free_slots.clear();
+    for (uint32_t i = static_cast<uint32_t>(slots.size()); i-- > 0;) {
+        slots[i].index = NO_NODE;
+        slots[i].generation++;
+        free_slots.push_back(i);
+    }
+    live_count = 0;
+    layout_dirty = false;
+    segments_valid = false;
+    next_id = 0;
+    transformsValid = false;
+    createNode(nullptr, NO_NODE, next_id);
 }
 
 void model_t::save(const std::string& filename) {
+    if (isBinaryModelName(filename)) {
+        saveBinary(filename);
+        return;
+    }
+
     std::ofstream file(filename);
     if (!file.is_open()) {
         std::cout << "Failed to save model to " << filename << std::endl;
         return;
     }
-    file << "MODEL_FILE_VERSION 1.0\n";
+    // Version 2 stores translation x y z, rotation as a w x y z quaternion and
+    // scale x y z; version 1 files (three 4x4 matrices) still load
+    file << "MODEL_FILE_VERSION 2.0\n";
     file << "SHAPE_COUNT " << getShapeCount() << "\n";
-    for (size_t i = 1; i < shapes.size(); ++i) {
-        const auto& m = shapes[i];
+    // Depth-first pool order: every parent is written before its children
+    ensureLayout();
+    for (size_t i = 1; i < nodes.size(); ++i) {
+        const model_node_t* m = &nodes[i];
         file << "SHAPE " << m->id << "\n";
         file << "TYPE " << static_cast<int>(m->type) << "\n";
-        file << "TRANSLATION ";
-        const float* tptr = glm::value_ptr(m->translation);
-        for (int k = 0; k < 16; ++k) file << tptr[k] << " ";
-        file << "\n";
-        file << "ROTATION ";
-        const float* rptr = glm::value_ptr(m->rotation);
-        for (int k = 0; k < 16; ++k) file << rptr[k] << " ";
-        file << "\n";
-        file << "SCALE ";
-        const float* sptr = glm::value_ptr(m->scale);
-        for (int k = 0; k < 16; ++k) file << sptr[k] << " ";
-        file << "\n";
+        file << "TRANSLATION " << m->translation.x << " " << m->translation.y << " " << m->translation.z << "\n";
+        file << "ROTATION " << m->rotation.w << " " << m->rotation.x << " " << m->rotation.y << " " << m->rotation.z << "\n";
+        file << "SCALE " << m->scale.x << " " << m->scale.y << " " << m->scale.z << "\n";
         int parent_id = -1;
-        if (auto p = m->parent.lock()) parent_id = p->id;
+        if (m->parent != NO_NODE) parent_id = nodes[m->parent].id;
         file << "PARENT " << parent_id << "\n";
         file << "COLOR " << m->color.r << " " << m->color.g << " " << m->color.b << " " << m->color.a << "\n";
     }
@@ -146,62 +611,18 @@ bool model_t::load(const std::string& filename) {
         return false;
     }
 
-    struct Entry {
-        int id; ShapeType type; glm::mat4 translation, rotation, scale; int parent_id; glm::vec4 color;
-    };
-    std::vector<Entry> entries;
-    std::string line;
-    while (std::getline(file, line)) {
-        std::istringstream iss(line);
-        std::string token;
-        iss >> token;
-        if (token == "SHAPE") {
-            Entry e{};
-            iss >> e.id;
-            std::streampos lastPos;
-            while (true) {
-                lastPos = file.tellg();
-                if (!std::getline(file, line)) break;
-                std::istringstream ps(line);
-                std::string prop; ps >> prop;
-                if (prop == "TYPE") { int t; ps >> t; e.type = static_cast<ShapeType>(t); }
-                else if (prop == "TRANSLATION") { float* ptr = glm::value_ptr(e.translation); for (int k=0; k<16; ++k) ps >> ptr[k]; }
-                else if (prop == "ROTATION") { float* ptr = glm::value_ptr(e.rotation); for (int k=0; k<16; ++k) ps >> ptr[k]; }
-                else if (prop == "SCALE") { float* ptr = glm::value_ptr(e.scale); for (int k=0; k<16; ++k) ps >> ptr[k]; }
-                else if (prop == "PARENT") { ps >> e.parent_id; }
-                else if (prop == "COLOR") { ps >> e.color.r >> e.color.g >> e.color.b >> e.color.a; }
-                else { file.seekg(lastPos); break; }
-            }
-            entries.push_back(e);
-        }
-    }
+    // The current meshes stay alive while the old nodes are cleared, so a
+    // reload using the same primitives keeps their geometry and GPU ranges
+    // instead of freeing them and building everything again
+    std::vector<std::shared_ptr<mesh_t>> keep = mesh_cache_t::instance().liveMeshes();
 
-    clear();
-    std::unordered_map<int, std::shared_ptr<model_node_t>> id_to_node;
-    id_to_node[getRoot()->id] = getRoot();
-
-    for (const auto& e : entries) {
-        std::unique_ptr<shape_t> s;
-        switch (e.type) {
-            case SPHERE_SHAPE: s = std::make_unique<sphere_t>(2); break;
-            case CYLINDER_SHAPE: s = std::make_unique<cylinder_t>(2); break;
-            case BOX_SHAPE: s = std::make_unique<box_t>(2); break;
-            case CONE_SHAPE: s = std::make_unique<cone_t>(2); break;
-        }
-        
-        addShapeToParent(e.parent_id, std::move(s));
-        
-        auto new_node = getLastNode();
-        if (new_node->shape) {
-            new_node->shape->setColor(e.color);
-        }
-        new_node->id = e.id;
-        new_node->translation = e.translation;
-        new_node->rotation = e.rotation;
-        new_node->scale = e.scale;
-        id_to_node[new_node->id] = new_node;
+    // Binary files are recognised by their magic number, not the extension
+    char magic[sizeof(MODB_MAGIC)] = {};
+    file.read(magic, sizeof(magic));
+    if (file.gcount() == sizeof(magic) && std::equal(magic, magic + sizeof(magic), MODB_MAGIC)) {
+        file.close();
+        return loadBinary(filename);
     }
     file.close();
-    std::cout << "Model loaded from " << filename << std::endl;
-    return true;
+    return loadText(filename);
 }
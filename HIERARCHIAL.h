@@ -3,64 +3,187 @@
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <GL/glew.h>
+#include <cstdint>
 #include <memory>
 #include <vector>
 #include <string>
+#include <unordered_map>
 #include "shape.h"
 
 // Shader program (declared in main.cpp)
 extern GLuint shaderProgram;
 
-// The single, unified node class for the scene hierarchy
-struct model_node_t : public std::enable_shared_from_this<model_node_t> {
-    inline static int next_id = 0;
-    int id;
-    std::shared_ptr<shape_t> shape; // Owns the shape data
-    ShapeType type;
-
-    // Transformations
-    glm::mat4 translation{1.0f};
-    glm::mat4 rotation{1.0f};
-    glm::mat4 scale{1.0f};
-    
-    // Hierarchy
-    std::weak_ptr<model_node_t> parent;
-    std::vector<std::shared_ptr<model_node_t>> children;
-    
+// "No node" value for the index links below
+constexpr uint32_t NO_NODE = 0xFFFFFFFFu;
+
+// Subtrees of up to this many nodes are one task of the parallel scene
+// update (model_t::updateTransforms() and collectVisible())
+constexpr uint32_t SCENE_TASK_NODES = 1024;
+
+// Stable reference to a node of a model_t. Nodes move inside the pool when
+// the model re-sorts it, so keep handles around, never model_node_t pointers.
+// A handle goes stale (getNode() returns nullptr) once its node is removed.
+struct node_handle_t {
+    uint32_t slot = NO_NODE;
+    uint32_t generation = 0;
+
+    bool isValid() const { return slot != NO_NODE; }
+    bool operator==(const node_handle_t& o) const { return slot == o.slot && generation == o.generation; }
+    bool operator!=(const node_handle_t& o) const { return !(*this == o); }
+};
+
+// The single, unified node class for the scene hierarchy. Nodes live by value
+// in model_t's pool and link to each other by pool index.
+struct model_node_t {
+    int id = 0;
+    std::unique_ptr<shape_t> shape; // Owns the shape data
+    ShapeType type = SPHERE_SHAPE;
+
+    // Transformations. The rotation is kept normalized by whoever edits it.
+    glm::vec3 translation{0.0f};
+    glm::quat rotation{1.0f, 0.0f, 0.0f, 0.0f}; // w, x, y, z
+    glm::vec3 scale{1.0f};
+
+    // Hierarchy, as indices into model_t's pool
+    uint32_t parent = NO_NODE;
+    uint32_t firstChild = NO_NODE;
+    uint32_t lastChild = NO_NODE;
+    uint32_t prevSibling = NO_NODE;
+    uint32_t nextSibling = NO_NODE;
+    uint32_t subtreeEnd = 0;  // one past the last descendant in pool order
+    uint32_t slot = NO_NODE;  // entry in the handle table, NO_NODE once removed
+
     // Properties
     glm::vec4 color{1.0f};
 
-    model_node_t(std::shared_ptr<shape_t> s = nullptr, ShapeType t = SPHERE_SHAPE);
-    void addChild(const std::shared_ptr<model_node_t>& child);
+    // Cached matrices, refreshed by model_t::updateTransforms()
+    glm::mat4 localMatrix{1.0f};
+    glm::mat4 worldMatrix{1.0f};
+    glm::mat4 mvpMatrix{1.0f};
+    bool localDirty = true; // translation/rotation/scale changed
+
+    // World-space bounds, refreshed together with the matrices: the node's
+    // own primitive, and the union over the node and all its descendants
+    aabb_t worldBounds;
+    aabb_t subtreeBounds;
+
+    // translate * rotate * scale
     glm::mat4 getTransform() const;
+    // Turns the node by angle (radians) around axis, in its local frame
+    void rotate(float angle, const glm::vec3& axis);
 };
 
-// Main model class containing the scene hierarchy
+// Version 1 model files stored translation, rotation and scale as three
+// column-major 4x4 matrices; these recover the compact form from them
+glm::vec3 translationFromMatrix(const float* m);
+glm::quat rotationFromMatrix(const float* m);
+glm::vec3 scaleFromMatrix(const float* m);
+
+// Main model class containing the scene hierarchy.
+// All nodes sit in one contiguous pool kept in depth-first order (the root is
+// always first and every subtree is the range [i, subtreeEnd)), so walking
+// the scene is a linear scan and a parent always comes before its children.
 class model_t {
 private:
-    std::vector<std::shared_ptr<model_node_t>> shapes; // A flat list for easy access
+    struct slot_t {
+        uint32_t index;      // position in the pool, NO_NODE while free
+        uint32_t generation; // bumped on every reuse to invalidate old handles
+    };
+
+    std::vector<model_node_t> nodes;      // the pool
+    std::vector<slot_t> slots;            // handle table
+    std::vector<uint32_t> free_slots;
+    std::vector<node_handle_t> added;     // insertion order, for getLastNode()
+    std::unordered_map<int, node_handle_t> id_index;
+    size_t live_count = 0;
+    bool layout_dirty = false;            // pool not in depth-first order
     int next_id = 0;
-    std::shared_ptr<model_node_t> findMNodeById(int id);
+    uint64_t revision = 0;                // see getRevision()
 
-public:
-    std::shared_ptr<model_node_t> root_node; // The single root of the scene
+    node_handle_t createNode(std::unique_ptr<shape_t> shape, uint32_t parent, int id);
+    uint32_t indexOf(node_handle_t h) const;
+    void unlink(uint32_t index);
+    void freeNode(uint32_t index);
+    void relayout();
+    void refreshBounds(uint32_t start, uint32_t end);
+    void refreshSubtreeBounds(uint32_t index);
+
+    // A piece of the pool for the parallel scene update. Spine segments are
+    // single nodes whose subtree is too big for one task; they are handled
+    // on the calling thread, parents first. The others are runs of whole
+    // sibling subtrees [start, end) under one spine node, which never
+    // depend on each other and go to task_pool_t.
+    struct segment_t {
+        uint32_t start, end;
+        uint32_t parent; // segment of the spine node above, NO_NODE for the first
+        bool spine;
+    };
+    void splitSubtrees(uint32_t top, std::vector<segment_t>& out) const;
+    const std::vector<segment_t>& rootSegments();
+    void updateSubtree(uint32_t start, const glm::mat4& rootTransform, const glm::mat4& viewProjection);
+    void updateMatrices(uint32_t start, uint32_t end, const glm::mat4& rootTransform, const glm::mat4& viewProjection);
+    std::vector<segment_t> root_segments;    // the whole pool, kept until the next relayout
+    bool segments_valid = false;
+    std::vector<segment_t> subtree_segments; // scratch for smaller dirty subtrees
+    std::vector<std::vector<const model_node_t*>> segment_visible;
 
+    // Inputs of the last updateTransforms() call
+    glm::mat4 lastRootTransform{1.0f};
+    glm::mat4 lastViewProjection{1.0f};
+    bool transformsValid = false;
+    std::vector<node_handle_t> dirty_roots; // subtrees whose world matrices are stale
+
+public:
     model_t();
-    std::shared_ptr<model_node_t> getRoot();
-    const std::vector<std::shared_ptr<model_node_t>>& getShapes() const;
+    node_handle_t getRoot() const;
+    model_node_t* getNode(node_handle_t h);
+    const model_node_t* getNode(node_handle_t h) const;
+    node_handle_t handleOf(uint32_t index) const;
+    node_handle_t getParent(node_handle_t h) const;
+    node_handle_t getFirstChild(node_handle_t h) const;
+    // O(1) lookup through the id index; invalid handle for unknown ids
+    node_handle_t findMNodeById(int id) const;
+    // The pool in depth-first order, root first
+    const std::vector<model_node_t>& getNodes();
     void addShape(std::unique_ptr<shape_t> shape);
     void addShapeToParent(int parent_ui_id, std::unique_ptr<shape_t> shape);
     void removeLastShape();
-    std::shared_ptr<model_node_t> getCurrentShape();
-    std::shared_ptr<model_node_t> getLastNode();
+    // Removes one node; its children move up to its parent and keep their
+    // local transforms. Returns false for unknown ids and for the root.
+    bool removeNode(int id);
+    // Removes a node together with everything below it
+    bool removeSubtree(int id);
+    node_handle_t getCurrentShape();
+    node_handle_t getLastNode();
     void rotateModel(char axis, bool positive);
+    // Call after editing a node's translation/rotation/scale
+    void markDirty(node_handle_t h);
+    // Changes with every edit: nodes added or removed, markDirty(), clear()
+    // and load(). The render loop compares it to the last frame it drew.
+    uint64_t getRevision() const { return revision; }
+    // Refreshes worldMatrix/mvpMatrix and the bounds of the nodes that changed
+    // since the last call; does nothing when neither the model nor the camera
+    // moved. Large subtrees are split into tasks on task_pool_t.
+    void updateTransforms(const glm::mat4& rootTransform, const glm::mat4& viewProjection);
+    // The frame's draw list: nodes with a shape whose bounds reach into the
+    // view frustum (every such node when cull is false), in pool order.
+    // Uses the bounds of the last updateTransforms().
+    void collectVisible(const glm::mat4& viewProjection, bool cull, std::vector<const model_node_t*>& out);
+    // Sorts the pool back into depth-first order after structural edits
+    void ensureLayout();
     void render(); 
     size_t getShapeCount() const;
     void clear();
+    // Names ending in .modb are written in the binary format (model_binary.h)
     void save(const std::string& filename);
+    // Accepts both the text and the binary format
     bool load(const std::string& filename);
+    bool loadText(const std::string& filename);
+    void saveBinary(const std::string& filename);
+    bool loadBinary(const std::string& filename);
 };
 
 #endif
@@ -0,0 +1,280 @@
+// Headless frame-time benchmark. Renders a synthetic scene (or a .mod/.modb
+// file) through renderFrame() into an offscreen framebuffer on an EGL
+// surfaceless context, so it runs on GPU-less machines with Mesa llvmpipe.
+//
+//   ./modeller_bench --nodes 20000 --depth 6 --fanout 8 --mix sphere:2,box:1
+//
+#include <GL/glew.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "globals.h"
+#include "mesh_arena.h"
+#include "render.h"
+#include "HIERARCHIAL.h"
+#include "synthetic_scene.h"
+
+namespace {
+
+struct bench_options_t {
+    synthetic_scene_t scene;
+    std::string file;        // load this instead of generating a scene
+    unsigned int frames = 200;
+    unsigned int warmup = 10;
+    bool animate = false;    // rotate the model every frame
+};
+
+const int FB_WIDTH = 800;
+const int FB_HEIGHT = 600;
+
+void printUsage() {
+    std::cout << "Usage: modeller_bench [options]\n"
+              << "  --nodes N        shapes in the synthetic scene (default 10000)\n"
+              << "  --depth N        maximum hierarchy depth (default 6)\n"
+              << "  --fanout N       children per node (default 8)\n"
+              << "  --level N        tesselation level 1-6 (default 2)\n"
+              << "  --mix LIST       primitive weights, e.g. sphere:2,cone:1,box:1,cylinder:1,icosphere:1\n"
+              << "  --seed N         random seed (default 1)\n"
+              << "  --file NAME      benchmark a .mod/.modb file instead\n"
+              << "  --frames N       timed frames (default 200)\n"
+              << "  --warmup N       untimed frames before measuring (default 10)\n"
+              << "  --instanced      use the instanced rendering path\n"
+              << "  --procedural     build primitives in the vertex shader (no mesh buffers)\n"
+              << "  --inspection     render in INSPECTION mode\n"
+              << "  --animate        rotate the model every frame\n"
+              << "  --no-cull        disable frustum culling\n"
+              << "  --lod            automatic level of detail\n"
+              << "  --wireframe      draw polygon outlines\n"
+              << "  --distance D     camera distance in INSPECTION mode (default 5)\n";
+}
+
+bool parseOptions(int argc, char** argv, bench_options_t& opt) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        auto number = [&](auto& out) {
+            if (!value) return false;
+            out = static_cast<std::remove_reference_t<decltype(out)>>(std::strtoul(value, nullptr, 10));
+            ++i;
+            return true;
+        };
+
+        bool ok = true;
+        if (arg == "--nodes") ok = number(opt.scene.nodes);
+        else if (arg == "--depth") ok = number(opt.scene.depth);
+        else if (arg == "--fanout") ok = number(opt.scene.fanout);
+        else if (arg == "--level") ok = number(opt.scene.level);
+        else if (arg == "--seed") ok = number(opt.scene.seed);
+        else if (arg == "--frames") ok = number(opt.frames);
+        else if (arg == "--warmup") ok = number(opt.warmup);
+        else if (arg == "--mix") ok = value && parsePrimitiveMix(argv[++i], opt.scene.mix);
+        else if (arg == "--file") ok = value && !(opt.file = argv[++i]).empty();
+        else if (arg == "--instanced") instancedRendering = true;
+        else if (arg == "--procedural") proceduralRendering = true;
+        else if (arg == "--inspection") currentMode = INSPECTION;
+        else if (arg == "--animate") opt.animate = true;
+        else if (arg == "--no-cull") frustumCulling = false;
+        else if (arg == "--lod") autoLod = true;
+        else if (arg == "--wireframe") Wireframe = true;
+        else if (arg == "--distance" && value) cameraDistance = std::strtof(argv[++i], nullptr);
+        else ok = false;
+
+        if (!ok) {
+            std::cout << "Bad argument: " << arg << "\n";
+            return false;
+        }
+    }
+    return opt.frames > 0;
+}
+
+// GL 3.3 core context without any surface; Mesa's surfaceless platform needs
+// neither a display server nor a GPU
+bool createHeadlessContext() {
+    EGLDisplay display = EGL_NO_DISPLAY;
+    auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+        eglGetProcAddress("eglGetPlatformDisplayEXT"));
+    if (getPlatformDisplay) {
+        display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    }
+    if (display == EGL_NO_DISPLAY) display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+    EGLint major = 0, minor = 0;
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor)) {
+        std::cout << "Failed to initialize EGL" << std::endl;
+        return false;
+    }
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        std::cout << "EGL has no desktop OpenGL support" << std::endl;
+        return false;
+    }
+
+    // Everything is drawn into our own FBO, so the config needs no surface type
+    const EGLint configAttribs[] = {
+        EGL_SURFACE_TYPE, 0,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_NONE
+    };
+    EGLConfig config = nullptr;
+    EGLint numConfigs = 0;
+    eglChooseConfig(display, configAttribs, &config, 1, &numConfigs);
+
+    const EGLint contextAttribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    EGLContext context = eglCreateContext(display, numConfigs > 0 ? config : EGL_NO_CONFIG_KHR,
+                                          EGL_NO_CONTEXT, contextAttribs);
+    if (context == EGL_NO_CONTEXT ||
+        !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+        std::cout << "Failed to create a GL 3.3 context (EGL " << major << "." << minor << ")" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool createFramebuffer() {
+    GLuint fbo, color, depth;
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+
+    glGenRenderbuffers(1, &color);
+    glBindRenderbuffer(GL_RENDERBUFFER, color);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, FB_WIDTH, FB_HEIGHT);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+
+    glGenRenderbuffers(1, &depth);
+    glBindRenderbuffer(GL_RENDERBUFFER, depth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, FB_WIDTH, FB_HEIGHT);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+
+    glViewport(0, 0, FB_WIDTH, FB_HEIGHT);
+    viewportWidth = FB_WIDTH;
+    viewportHeight = FB_HEIGHT;
+    return glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+}
+
+double percentile(const std::vector<double>& sorted, double p) {
+    size_t k = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(k, sorted.size() - 1)];
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    bench_options_t opt;
+    if (!parseOptions(argc, argv, opt)) {
+        printUsage();
+        return 1;
+    }
+
+    if (!createHeadlessContext()) return -1;
+
+    glewExperimental = GL_TRUE;
+    GLenum glewStatus = glewInit();
+    // GLEW builds that expect GLX report this under EGL, but still load the
+    // entry points
+    if (glewStatus != GLEW_OK && glewStatus != GLEW_ERROR_NO_GLX_DISPLAY) {
+        std::cerr << "Failed to initialize GLEW: " << glewGetErrorString(glewStatus) << std::endl;
+        return -1;
+    }
+    if (!createFramebuffer()) {
+        std::cerr << "Failed to create the offscreen framebuffer\n";
+        return -1;
+    }
+    if (!initRenderer()) {
+        std::cerr << "Failed to create shader program\n";
+        return -1;
+    }
+
+    currentModel = std::make_shared<model_t>();
+    auto loadStart = std::chrono::steady_clock::now();
+    if (!opt.file.empty()) {
+        if (!currentModel->load(opt.file)) return -1;
+    } else {
+        generateSyntheticModel(*currentModel, opt.scene);
+    }
+    if (autoLod) mesh_cache_t::instance().precomputeLods();
+    // Measure drawing, not streaming: every mesh is built and on the GPU first
+    mesh_builder_t& builder = mesh_builder_t::instance();
+    builder.waitIdle();
+    if (!proceduralRendering) builder.uploadFinished(std::numeric_limits<double>::infinity());
+    double loadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - loadStart).count();
+
+    std::cout << "Renderer: " << glGetString(GL_RENDERER) << "\n"
+              << "Scene: " << currentModel->getShapeCount() << " nodes, "
+              << mesh_cache_t::instance().size() << " meshes, built in " << loadMs << " ms\n"
+              << "Path: " << (proceduralRendering ? "procedural" : instancedRendering ? "instanced" : "per-node")
+              << (currentMode == INSPECTION ? ", inspection" : ", modelling")
+              << (opt.animate ? ", animated" : "") << (frustumCulling ? "" : ", no culling")
+              << (autoLod ? ", auto LOD" : "") << "\n";
+
+    // Generated meshes also show the ratio in the order they were generated in
+    std::cout << "Vertex cache ACMR (" << VERTEX_CACHE_SIZE << " entries):" << std::setprecision(3);
+    for (const auto& mesh : mesh_cache_t::instance().liveMeshes()) {
+        if (!mesh->isBuilt()) continue;
+        std::cout << " " << shapeTypeName(mesh->type) << "/" << mesh->level << " ";
+        if (!mesh->table) std::cout << mesh->optimizeStats.acmrBefore << "->";
+        std::cout << mesh->cacheMissRatio();
+    }
+    std::cout << std::setprecision(6) << "\n";
+
+    std::vector<double> frameMs;
+    frameMs.reserve(opt.frames);
+    unsigned long long drawCalls = 0, stateChanges = 0, uniformUploads = 0, nodesDrawn = 0, triangles = 0;
+    for (unsigned int f = 0; f < opt.warmup + opt.frames; ++f) {
+        if (opt.animate) {
+            modelRotation = glm::rotate(modelRotation, glm::radians(1.0f), glm::vec3(0, 1, 0));
+        }
+        auto start = std::chrono::steady_clock::now();
+        renderFrame();
+        glFinish();
+        auto end = std::chrono::steady_clock::now();
+
+        if (f < opt.warmup) continue;
+        frameMs.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+        drawCalls += renderStats.drawCalls;
+        stateChanges += renderStats.stateChanges;
+        uniformUploads += renderStats.uniformUploads;
+        nodesDrawn += renderStats.nodesDrawn;
+        triangles += renderStats.triangles;
+    }
+
+    GLenum err = glGetError();
+    if (err != GL_NO_ERROR) std::cout << "GL error 0x" << std::hex << err << std::dec << "\n";
+
+    double total = 0.0;
+    for (double ms : frameMs) total += ms;
+    std::sort(frameMs.begin(), frameMs.end());
+
+    std::cout << "Frames: " << frameMs.size() << "\n"
+              << "Frame time (ms): mean " << total / frameMs.size()
+              << "  p50 " << percentile(frameMs, 0.50)
+              << "  p90 " << percentile(frameMs, 0.90)
+              << "  p99 " << percentile(frameMs, 0.99)
+              << "  max " << frameMs.back() << "\n"
+              << "Draw calls per frame: " << drawCalls / frameMs.size() << "\n"
+              << "State changes per frame: " << stateChanges / frameMs.size() << "\n"
+              << "Uniform uploads per frame: " << uniformUploads / frameMs.size() << "\n"
+              << "Nodes drawn per frame: " << nodesDrawn / frameMs.size() << "\n"
+              << "Triangles per frame: " << triangles / frameMs.size() << "\n"
+              << "Mesh storage (KB): used " << mesh_arena_t::instance().usedBytes() / 1024
+              << "  allocated " << mesh_arena_t::instance().storageBytes() / 1024 << std::endl;
+
+    currentModel.reset();
+    return 0;
+}
@@ -0,0 +1,81 @@
+#ifndef BOUNDS_H
+#define BOUNDS_H
+
+#include <glm/glm.hpp>
+#include <cmath>
+#include <limits>
+
+// Axis-aligned bounding box. A default-constructed box is empty and grows
+// with expand(); empty boxes are never inside a frustum.
+struct aabb_t {
+    glm::vec3 min{std::numeric_limits<float>::max()};
+    glm::vec3 max{-std::numeric_limits<float>::max()};
+
+    bool isEmpty() const { return min.x > max.x; }
+
+    void expand(const glm::vec3& p) {
+        min = glm::min(min, p);
+        max = glm::max(max, p);
+    }
+
+    void expand(const aabb_t& b) {
+        if (b.isEmpty()) return;
+        min = glm::min(min, b.min);
+        max = glm::max(max, b.max);
+    }
+
+    // Box around this box after the affine transform m (Arvo's method: the
+    // centre is transformed, the half extents go through |m|)
+    aabb_t transformed(const glm::mat4& m) const {
+        if (isEmpty()) return *this;
+        glm::vec3 center = 0.5f * (min + max);
+        glm::vec3 extent = 0.5f * (max - min);
+
+        glm::vec3 c = glm::vec3(m * glm::vec4(center, 1.0f));
+        glm::vec3 e(0.0f);
+        for (int col = 0; col < 3; ++col) {
+            e += glm::vec3(std::fabs(m[col][0]), std::fabs(m[col][1]), std::fabs(m[col][2])) * extent[col];
+        }
+        aabb_t out;
+        out.min = c - e;
+        out.max = c + e;
+        return out;
+    }
+};
+
+// The six clip planes of a view-projection matrix (Gribb/Hartmann), normals
+// pointing inwards
+struct frustum_t {
+    enum result_t { OUTSIDE, INTERSECTS, INSIDE };
+
+    glm::vec4 planes[6];
+
+    explicit frustum_t(const glm::mat4& m) {
+        glm::vec4 row[4];
+        for (int r = 0; r < 4; ++r) row[r] = glm::vec4(m[0][r], m[1][r], m[2][r], m[3][r]);
+        for (int axis = 0; axis < 3; ++axis) {
+            planes[2 * axis] = row[3] + row[axis];
+            planes[2 * axis + 1] = row[3] - row[axis];
+        }
+    }
+
+    result_t classify(const aabb_t& box) const {
+        if (box.isEmpty()) return OUTSIDE;
+        result_t result = INSIDE;
+        for (const glm::vec4& p : planes) {
+            glm::vec3 n(p);
+            // Corners furthest along and against the plane normal
+            glm::vec3 positive(n.x >= 0 ? box.max.x : box.min.x,
+                          n.y >= 0 ? box.max.y : box.min.y,
+                          n.z >= 0 ? box.max.z : box.min.z);
+            glm::vec3 negative(n.x >= 0 ? box.min.x : box.max.x,
+                           n.y >= 0 ? box.min.y : box.max.y,
+                           n.z >= 0 ? box.min.z : box.max.z);
+            if (glm::dot(n, positive) + p.w < 0.0f) return OUTSIDE;
+            if (glm::dot(n, negative) + p.w < 0.0f) result = INTERSECTS;
+        }
+        return result;
+    }
+};
+
+#endif
@@ -0,0 +1,123 @@
+#include "console.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <poll.h>
+#include <sstream>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// How often a reader with nothing to read checks for stop()
+constexpr int CONSOLE_POLL_MS = 100;
+
+console_t& console_t::instance() {
+    static console_t console;
+    return console;
+}
+
+console_t::~console_t() {
+    stop();
+    entry_t* list = queued.exchange(nullptr);
+    while (list) {
+        entry_t* next = list->next;
+        delete list;
+        list = next;
+    }
+}
+
+bool console_t::start(const std::string& pipePath) {
+    if (reader.joinable()) return true;
+    if (pipePath.empty()) {
+        fd = STDIN_FILENO;
+        ownsFd = false;
+    } else {
+        if (mkfifo(pipePath.c_str(), 0600) != 0 && errno != EEXIST) {
+            std::cout << "Failed to create command pipe " << pipePath << ": " << std::strerror(errno) << std::endl;
+            return false;
+        }
+        // Opened for writing as well, so the pipe neither blocks here until a
+        // writer appears nor reports end of file each time a writer leaves
+        fd = open(pipePath.c_str(), O_RDWR | O_NONBLOCK);
+        if (fd < 0) {
+            std::cout << "Failed to open command pipe " << pipePath << ": " << std::strerror(errno) << std::endl;
+            return false;
+        }
+        ownsFd = true;
+        std::cout << "Reading commands from " << pipePath << std::endl;
+    }
+    stopping.store(false, std::memory_order_relaxed);
+    reader = std::thread(&console_t::readerLoop, this);
+    return true;
+}
+
+void console_t::stop() {
+    stopping.store(true, std::memory_order_relaxed);
+    if (reader.joinable()) reader.join();
+    if (ownsFd) close(fd);
+    fd = -1;
+    ownsFd = false;
+}
+
+void console_t::readerLoop() {
+    std::string pending; // a line still waiting for its newline
+    char buffer[4096];
+    while (!stopping.load(std::memory_order_relaxed)) {
+        pollfd p{fd, POLLIN, 0};
+        int ready = poll(&p, 1, CONSOLE_POLL_MS);
+        if (ready < 0 && errno != EINTR) break;
+        if (ready <= 0) continue;
+
+        ssize_t n = read(fd, buffer, sizeof(buffer));
+        if (n < 0 && (errno == EAGAIN || errno == EINTR)) continue;
+        if (n <= 0) break; // stdin closed; the pipe never gets here
+
+        pending.append(buffer, static_cast<size_t>(n));
+        size_t begin = 0;
+        for (size_t end; (end = pending.find('\n', begin)) != std::string::npos; begin = end + 1) {
+            push(pending.substr(begin, end - begin));
+        }
+        pending.erase(0, begin);
+    }
+    if (!pending.empty()) push(pending);
+}
+
+// Blank lines and # comments (for scripts) are dropped here
+void console_t::push(const std::string& line) {
+    entry_t* entry = new entry_t{{}, nullptr};
+    std::istringstream words(line);
+    for (std::string w; words >> w;) {
+        if (w[0] == '#') break;
+        entry->command.words.push_back(std::move(w));
+    }
+    if (entry->command.words.empty()) {
+        delete entry;
+        return;
+    }
+
+    // The entry may be drained and freed as soon as it is published, so the
+    // old top is kept here
+    entry_t* top = queued.load(std::memory_order_relaxed);
+    do {
+        entry->next = top;
+    } while (!queued.compare_exchange_weak(top, entry, std::memory_order_release, std::memory_order_relaxed));
+    // A non-empty stack has already woken the render thread, which has yet
+    // to drain it; a script sending thousands of lines wakes it once a frame
+    if (top) return;
+    if (void (*callback)() = onCommand.load(std::memory_order_acquire)) callback();
+}
+
+void console_t::drain(std::vector<console_command_t>& out) {
+    out.clear();
+    // Taking the whole stack at once leaves no ABA window; it comes out
+    // newest first, so flip it to run commands in the order they were typed
+    entry_t* list = queued.exchange(nullptr, std::memory_order_acquire);
+    while (list) {
+        out.push_back(std::move(list->command));
+        entry_t* next = list->next;
+        delete list;
+        list = next;
+    }
+    std::reverse(out.begin(), out.end());
+}
@@ -0,0 +1,57 @@
+#ifndef CONSOLE_H
+#define CONSOLE_H
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+// One line typed on the console, split at whitespace
+struct console_command_t {
+    std::vector<std::string> words;
+};
+
+// Reads commands (see runCommand() in input.cpp) on a thread of its own, so
+// neither the key callback nor the render loop ever waits for typing. The
+// source is stdin or a named pipe that scripts can write to; the pipe is
+// kept open between writers. Parsed lines go onto a lock-free stack that
+// the render thread takes as a whole in drain(), once per loop iteration.
+class console_t {
+public:
+    static console_t& instance();
+    ~console_t();
+
+    console_t(const console_t&) = delete;
+    console_t& operator=(const console_t&) = delete;
+
+    // Starts reading stdin, or the named pipe at pipePath (created when
+    // missing). Returns false if the pipe cannot be opened.
+    bool start(const std::string& pipePath = "");
+    void stop();
+    // Called on the reader thread when a command arrives while none are
+    // queued, e.g. glfwPostEmptyEvent to wake a render loop sleeping in
+    // glfwWaitEvents(); nullptr for none
+    void setCommandCallback(void (*callback)()) { onCommand.store(callback, std::memory_order_release); }
+    // Render thread only: replaces out with the queued commands, oldest first
+    void drain(std::vector<console_command_t>& out);
+
+private:
+    console_t() = default;
+    void readerLoop();
+    void push(const std::string& line);
+
+    struct entry_t {
+        console_command_t command;
+        entry_t* next;
+    };
+    // Pushed by the reader, taken as a whole by the render thread
+    std::atomic<entry_t*> queued{nullptr};
+    std::atomic<void (*)()> onCommand{nullptr};
+
+    int fd = -1;
+    bool ownsFd = false;          // the pipe; stdin is left open
+    std::atomic<bool> stopping{false};
+    std::thread reader;
+};
+
+#endif
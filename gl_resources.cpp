@@ -0,0 +1,34 @@
+#include "gl_resources.h"
+
+// Never destroyed, like the mesh arena that hands buffers back to it
+gl_buffer_pool_t& gl_buffer_pool_t::instance() {
+    static gl_buffer_pool_t* pool = new gl_buffer_pool_t();
+    return *pool;
+}
+
+pooled_buffer_t gl_buffer_pool_t::acquire(size_t bytes) {
+    size_t sizeClass = 256;
+    while (sizeClass < bytes) sizeClass *= 2;
+
+    pooled_buffer_t out;
+    out.bytes = sizeClass;
+    auto it = buckets.find(sizeClass);
+    if (it != buckets.end() && !it->second.empty()) {
+        out.buffer = std::move(it->second.back());
+        it->second.pop_back();
+        idle -= sizeClass;
+        return out;
+    }
+
+    out.buffer = makeBuffer();
+    glBindBuffer(GL_COPY_WRITE_BUFFER, out.buffer.get());
+    glBufferData(GL_COPY_WRITE_BUFFER, sizeClass, nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    return out;
+}
+
+void gl_buffer_pool_t::recycle(pooled_buffer_t buffer) {
+    if (!buffer.buffer || idle + buffer.bytes > MAX_IDLE_BYTES) return; // deleted by the handle
+    idle += buffer.bytes;
+    buckets[buffer.bytes].push_back(std::move(buffer.buffer));
+}
@@ -0,0 +1,94 @@
+#ifndef GL_RESOURCES_H
+#define GL_RESOURCES_H
+
+#include <GL/glew.h>
+#include <cstddef>
+#include <map>
+#include <vector>
+
+struct gl_buffer_deleter_t {
+    void operator()(GLuint id) const { glDeleteBuffers(1, &id); }
+};
+
+struct gl_vertex_array_deleter_t {
+    void operator()(GLuint id) const { glDeleteVertexArrays(1, &id); }
+};
+
+// Owns one GL object name: move-only, and the object is deleted when the
+// handle is reset or goes out of scope
+template <typename Deleter>
+class gl_handle_t {
+public:
+    gl_handle_t() = default;
+    explicit gl_handle_t(GLuint id) : id(id) {}
+    ~gl_handle_t() { reset(); }
+
+    gl_handle_t(const gl_handle_t&) = delete;
+    gl_handle_t& operator=(const gl_handle_t&) = delete;
+    gl_handle_t(gl_handle_t&& o) noexcept : id(o.release()) {}
+    gl_handle_t& operator=(gl_handle_t&& o) noexcept {
+        if (this != &o) reset(o.release());
+        return *this;
+    }
+
+    GLuint get() const { return id; }
+    explicit operator bool() const { return id != 0; }
+
+    GLuint release() {
+        GLuint old = id;
+        id = 0;
+        return old;
+    }
+
+    void reset(GLuint next = 0) {
+        if (id != 0) Deleter()(id);
+        id = next;
+    }
+
+private:
+    GLuint id = 0;
+};
+
+using gl_buffer_t = gl_handle_t<gl_buffer_deleter_t>;
+using gl_vertex_array_t = gl_handle_t<gl_vertex_array_deleter_t>;
+
+inline gl_buffer_t makeBuffer() {
+    GLuint id = 0;
+    glGenBuffers(1, &id);
+    return gl_buffer_t(id);
+}
+
+inline gl_vertex_array_t makeVertexArray() {
+    GLuint id = 0;
+    glGenVertexArrays(1, &id);
+    return gl_vertex_array_t(id);
+}
+
+// A buffer together with the size of its storage
+struct pooled_buffer_t {
+    gl_buffer_t buffer;
+    size_t bytes = 0;
+};
+
+// Recycles GL buffers in power-of-two size classes. Storage given up by one
+// user (say, a mesh arena pool that outgrew it) goes to the next request of
+// the same class instead of being freed and allocated again.
+class gl_buffer_pool_t {
+public:
+    static gl_buffer_pool_t& instance();
+
+    // A buffer with at least `bytes` of storage, rounded up to the size class
+    pooled_buffer_t acquire(size_t bytes);
+    // Takes a buffer back; beyond MAX_IDLE_BYTES of idle storage it is deleted
+    void recycle(pooled_buffer_t buffer);
+
+    size_t idleBytes() const { return idle; }
+
+    static constexpr size_t MAX_IDLE_BYTES = 64u << 20;
+
+private:
+    std::map<size_t, std::vector<gl_buffer_t>> buckets; // size class -> idle buffers
+    size_t idle = 0;
+};
+
+#endif
@@ -1,11 +1,23 @@
 #pragma once
 #include <glm/glm.hpp>
 #include <GL/glew.h>
+#include <memory>
 
 
 extern glm::mat4 projection;
 extern glm::mat4 view;
+// Size of the render target in pixels, kept up to date by whoever creates it
+// (the window in main.cpp, the framebuffer in benchmark.cpp)
+extern int viewportWidth, viewportHeight;
 extern GLuint shaderProgram;
+extern GLuint instancedShaderProgram;
+extern GLuint proceduralShaderProgram;
+extern bool instancedRendering; // draw nodes sharing a mesh with one instanced call
+extern bool proceduralRendering; // build primitives in the vertex shader, no mesh buffers
+extern bool frustumCulling;     // skip nodes whose bounds are outside the view
+extern bool autoLod;            // pick tesselation levels from screen size
+extern bool Wireframe;          // polygon mode GL_LINE instead of GL_FILL
+extern bool continuousRendering; // draw every loop iteration, not on demand
 
 enum Mode { MODELLING, INSPECTION };
 enum TransformMode { NONE, ROTATE, TRANSLATE, SCALE };
@@ -14,9 +26,10 @@ extern Mode currentMode;
 extern TransformMode transformMode;
 extern char activeAxis;
 struct model_node_t;
-struct model_t; 
+struct node_handle_t;
+class model_t; 
 extern std::shared_ptr<model_t> currentModel;
-extern std::shared_ptr<model_node_t> currentNode;
+extern node_handle_t currentNode;
 
 extern float cameraDistance, cameraAngleX, cameraAngleY;
 extern glm::mat4 modelRotation;
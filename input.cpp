@@ -3,47 +3,65 @@
 #include <glm/glm.hpp>   
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <string>
+#include <vector>
 #include "shape.h"
 #include "globals.h"
 #include "input.h"
+#include "console.h"
+#include "render.h"
 #include "HIERARCHIAL.h"
 
 
-bool Wireframe = false;
 bool tesselationMode = false;
+// Set by the C, S and L keys: the next console line may leave out the
+// command name, e.g. "0.2 0.4 1" after C
+std::string promptedCommand;
+
+// Resolves the selected node; only valid until the model is next edited
+model_node_t* getCurrentNode() {
+    return currentModel ? currentModel->getNode(currentNode) : nullptr;
+}
+
 shape_t* getCurrentShape() {
-    if (currentNode && currentNode->shape) {
-        return currentNode->shape.get();  // unique_ptr -> raw pointer
+    model_node_t* node = getCurrentNode();
+    if (node && node->shape) {
+        return node->shape.get();  // unique_ptr -> raw pointer
     }
     return nullptr;
 }
 
 void applyTransform(int direction) {
-    if (!currentNode) return;
+    model_node_t* node = getCurrentNode();
+    if (!node) return;
 
     float step = 0.1f;
     float angle = glm::radians(5.0f);
 
     switch (transformMode) {
         case TRANSLATE:
-            if (activeAxis == 'X') currentNode->translation = glm::translate(currentNode->translation, glm::vec3(direction * step, 0, 0));
-            if (activeAxis == 'Y') currentNode->translation = glm::translate(currentNode->translation, glm::vec3(0, direction * step, 0));
-            if (activeAxis == 'Z') currentNode->translation = glm::translate(currentNode->translation, glm::vec3(0, 0, direction * step));
+            if (activeAxis == 'X') node->translation.x += direction * step;
+            if (activeAxis == 'Y') node->translation.y += direction * step;
+            if (activeAxis == 'Z') node->translation.z += direction * step;
             break;
         case ROTATE:
-            if (activeAxis == 'X') currentNode->rotation = glm::rotate(currentNode->rotation, direction * angle, glm::vec3(1, 0, 0));
-            if (activeAxis == 'Y') currentNode->rotation = glm::rotate(currentNode->rotation, direction * angle, glm::vec3(0, 1, 0));
-            if (activeAxis == 'Z') currentNode->rotation = glm::rotate(currentNode->rotation, direction * angle, glm::vec3(0, 0, 1));
+            if (activeAxis == 'X') node->rotate(direction * angle, glm::vec3(1, 0, 0));
+            if (activeAxis == 'Y') node->rotate(direction * angle, glm::vec3(0, 1, 0));
+            if (activeAxis == 'Z') node->rotate(direction * angle, glm::vec3(0, 0, 1));
             break;
         case SCALE:
-            if (activeAxis == 'X') currentNode->scale = glm::scale(currentNode->scale, glm::vec3(1 + direction * 0.1f, 1, 1));
-            if (activeAxis == 'Y') currentNode->scale = glm::scale(currentNode->scale, glm::vec3(1, 1 + direction * 0.1f, 1));
-            if (activeAxis == 'Z') currentNode->scale = glm::scale(currentNode->scale, glm::vec3(1, 1, 1 + direction * 0.1f));
+            if (activeAxis == 'X') node->scale.x *= 1 + direction * 0.1f;
+            if (activeAxis == 'Y') node->scale.y *= 1 + direction * 0.1f;
+            if (activeAxis == 'Z') node->scale.z *= 1 + direction * 0.1f;
             break;
         default:
-            break;
+            return;
     }
+    currentModel->markDirty(currentNode);
 }
 void setupOpenGL();
 void renderScene(GLuint shaderProgram);
@@ -55,24 +73,46 @@ void printInstructions();
 void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods) {
     if (action != GLFW_PRESS && action != GLFW_REPEAT) return;
    
-    
+    // Mode and display settings change the picture without editing the
+    // model, so they ask for the frame themselves
     if (key == GLFW_KEY_M) {
         currentMode = MODELLING;
         std::cout << "Mode: MODELLING" << std::endl;
+        requestRedraw();
     }
     else if (key == GLFW_KEY_I) {
         currentMode = INSPECTION;
         std::cout << "Mode: INSPECTION" << std::endl;
+        requestRedraw();
+    }
+    else if (key == GLFW_KEY_W) {
+        Wireframe = !Wireframe; // the render queue applies it next frame
+        requestRedraw();
+    }
+    else if (key == GLFW_KEY_N) {
+        instancedRendering = !instancedRendering;
+        std::cout << "Rendering: " << (instancedRendering ? "INSTANCED" : "PER-NODE") << std::endl;
+        requestRedraw();
+    }
+    else if (key == GLFW_KEY_P) {
+        proceduralRendering = !proceduralRendering;
+        std::cout << "Procedural primitives: " << (proceduralRendering ? "ON" : "OFF") << std::endl;
+        requestRedraw();
+    }
+    else if (key == GLFW_KEY_F) {
+        frustumCulling = !frustumCulling;
+        std::cout << "Frustum culling: " << (frustumCulling ? "ON" : "OFF") << std::endl;
+        requestRedraw();
+    }
+    else if (key == GLFW_KEY_O) {
+        autoLod = !autoLod;
+        std::cout << "Automatic LOD: " << (autoLod ? "ON" : "OFF") << std::endl;
+        requestRedraw();
+    }
+    else if (key == GLFW_KEY_K) {
+        continuousRendering = !continuousRendering;
+        std::cout << "Rendering: " << (continuousRendering ? "CONTINUOUS" : "ON DEMAND") << std::endl;
     }
-    else if (key == GLFW_KEY_W ){
-    Wireframe = !Wireframe;
-    
-   if (Wireframe){
-      glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);}
-   else
-   {
-      glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-   }}
     else if (key == GLFW_KEY_ESCAPE) {
         glfwSetWindowShouldClose(window, GLFW_TRUE);
     }
@@ -89,16 +129,16 @@ void handleModellingKeys(int key) {
         
 
         case GLFW_KEY_U: // Move UP to parent
-            if (currentNode->parent.lock()) {
-                currentNode = currentNode->parent.lock();
+            if (currentModel->getParent(currentNode).isValid()) {
+                currentNode = currentModel->getParent(currentNode);
                 std::cout << "Selected parent node.\n";
             } else {
                 std::cout << "Already at the root node.\n";
             }
             break;
         case GLFW_KEY_J: // Move DOWN to first child
-            if (!currentNode->children.empty()) {
-                currentNode = currentNode->children.front();
+            if (currentModel->getFirstChild(currentNode).isValid()) {
+                currentNode = currentModel->getFirstChild(currentNode);
                 std::cout << "Selected first child node.\n";
             } else {
                 std::cout << "Selected node has no children.\n";
@@ -143,16 +183,12 @@ void handleModellingKeys(int key) {
             applyTransform(-1);
             break;
 
-        // Change color
-        case GLFW_KEY_C: {
-            float r, g, b;
-            std::cout << "Enter RGB values (0-1): ";
-            std::cin >> r >> g >> b;
-            if (currentNode && currentNode->shape) {
-                currentNode->shape->setColor(glm::vec4(r, g, b, 1.0f));
-            }
+        // Change color; the values come from the console
+        case GLFW_KEY_C:
+            promptedCommand = "color";
+            std::cout << "Enter RGB values (0-1) on the console: ";
+            std::cout.flush();
             break;
-        }
         //Tesselation implementation
          case GLFW_KEY_A:
             tesselationMode = !tesselationMode;
@@ -160,9 +196,9 @@ void handleModellingKeys(int key) {
                 std::cout << "TESSELLATION MODE ACTIVATED " << std::endl;
                 std::cout << "Press number keys 1-6 to set tessellation level" << std::endl;
                 std::cout << "Press A again to exit tessellation mode" << std::endl;
-                if (currentNode && currentNode->shape) {
-                    std::cout << "Current tessellation level: " << currentNode->shape->getLevel() << std::endl;
-                    std::cout << "Current triangle count: " << currentNode->shape->indices.size() / 3 << std::endl;
+                if (shape_t* shape = getCurrentShape()) {
+                    std::cout << "Current tessellation level: " << shape->getLevel() << std::endl;
+                    std::cout << "Current triangle count: " << shape->getTriangleCount() << std::endl;
                 } else {
                     std::cout << "No shape selected!" << std::endl;
                 }
@@ -173,82 +209,106 @@ void handleModellingKeys(int key) {
         
     // Add shapes
         case GLFW_KEY_1:
-          if (tesselationMode && currentNode && currentNode->shape) {
-                currentNode->shape->setLevel(1);
+          if (tesselationMode && getCurrentShape()) {
+                getCurrentShape()->setLevel(1);
             } else if (!tesselationMode) {
             currentModel->addShape(std::make_unique<sphere_t>(1));
             currentNode = currentModel->getLastNode();
             std::cout << "Sphere added\n";}
             break;
         case GLFW_KEY_2:
-          if (tesselationMode && currentNode && currentNode->shape) {
-                currentNode->shape->setLevel(2);
+          if (tesselationMode && getCurrentShape()) {
+                getCurrentShape()->setLevel(2);
             } else if (!tesselationMode) {
             currentModel->addShape(std::make_unique<cylinder_t>(1));
             currentNode = currentModel->getLastNode();
             std::cout << "Cylinder added\n";}
             break;
         case GLFW_KEY_3:
-         if (tesselationMode && currentNode && currentNode->shape) {
-                currentNode->shape->setLevel(3);
+         if (tesselationMode && getCurrentShape()) {
+                getCurrentShape()->setLevel(3);
             } else if (!tesselationMode) {
             currentModel->addShape(std::make_unique<box_t>(1));
             currentNode = currentModel->getLastNode();
             std::cout << "Box added\n";}
             break;
         case GLFW_KEY_4:
-          if (tesselationMode && currentNode && currentNode->shape) {
-                currentNode->shape->setLevel(4);
+          if (tesselationMode && getCurrentShape()) {
+                getCurrentShape()->setLevel(4);
             } else if (!tesselationMode) {
             currentModel->addShape(std::make_unique<cone_t>(1));
             currentNode = currentModel->getLastNode();
             std::cout << "Cone added\n";}
             break;
         case GLFW_KEY_5:
-         if (tesselationMode && currentNode && currentNode->shape) {
-                currentNode->shape->setLevel(5);
+         if (tesselationMode && getCurrentShape()) {
+                getCurrentShape()->setLevel(5);
             } else if (!tesselationMode) {
             currentModel->removeLastShape();
             currentNode = currentModel->getLastNode();
             std::cout << "Last shape removed\n";}
             break;
+        // Remove the selected node (children move up) or its whole subtree
+        case GLFW_KEY_BACKSPACE:
+        case GLFW_KEY_DELETE: {
+            model_node_t* node = getCurrentNode();
+            node_handle_t parent = currentModel->getParent(currentNode);
+            if (!node || !parent.isValid()) {
+                std::cout << "Cannot remove the root node.\n";
+                break;
+            }
+            int id = node->id;
+            if (key == GLFW_KEY_DELETE) currentModel->removeSubtree(id);
+            else currentModel->removeNode(id);
+            currentNode = parent;
+            std::cout << (key == GLFW_KEY_DELETE ? "Subtree removed\n" : "Node removed\n");
+            break;
+        }
         case GLFW_KEY_6:
-            if (tesselationMode && currentNode && currentNode->shape) {
-                currentNode->shape->setLevel(6);
+            if (tesselationMode && getCurrentShape()) {
+                getCurrentShape()->setLevel(6);
             }
             break;   
-        // Save model
-        case GLFW_KEY_S: {
-            
-            std::string filename;
-            std::cout << "Enter filename (with .mod extension): ";
-            std::cin >> filename;
-            if (filename.find(".mod") == std::string::npos) {
-                filename += ".mod";
+        case GLFW_KEY_7:
+            if (!tesselationMode) {
+                currentModel->addShape(std::make_unique<icosphere_t>(1));
+                currentNode = currentModel->getLastNode();
+                std::cout << "Icosphere added\n";
+            }
+            break;
+        // Switch the selected sphere between the UV and icosahedron meshes
+        case GLFW_KEY_V: {
+            model_node_t* node = getCurrentNode();
+            if (!node || !node->shape || (node->type != SPHERE_SHAPE && node->type != ICOSPHERE_SHAPE)) {
+                std::cout << "Select a sphere first.\n";
+                break;
             }
-            currentModel->save(filename);
+            ShapeType type = node->type == SPHERE_SHAPE ? ICOSPHERE_SHAPE : SPHERE_SHAPE;
+            std::unique_ptr<shape_t> shape = makeShape(type, node->shape->getLevel());
+            if (node->shape->hasColor) shape->setColor(node->shape->color);
+            node->shape = std::move(shape);
+            node->type = type;
+            requestRedraw();
+            std::cout << (type == ICOSPHERE_SHAPE ? "Sphere style: ICOSPHERE\n" : "Sphere style: UV\n");
             break;
         }
+        // Save model; the filename comes from the console
+        case GLFW_KEY_S:
+            promptedCommand = "save";
+            std::cout << "Enter filename (.mod for text, .modb for binary) on the console: ";
+            std::cout.flush();
+            break;
     }
 }
 
 void handleInspectionKeys(int key) {
     switch (key) {
-        // Load model
-        case GLFW_KEY_L: {
-            std::string filename;
-            std::cout << "Enter filename to load: ";
-            std::cin >> filename;
-            if (currentModel->load(filename)) {
-                currentNode = currentModel->getLastNode();
-                // Reset camera to view loaded model
-                cameraDistance = 5.0f;
-                cameraAngleX = 0.0f;
-                cameraAngleY = 0.0f;
-                modelRotation = glm::mat4(1.0f);
-            }
+        // Load model; the filename comes from the console
+        case GLFW_KEY_L:
+            promptedCommand = "load";
+            std::cout << "Enter filename to load on the console: ";
+            std::cout.flush();
             break;
-        }
         
         // Model rotation mode
         case GLFW_KEY_R:
@@ -280,6 +340,7 @@ void handleInspectionKeys(int key) {
                     case 'Y': modelRotation = glm::rotate(modelRotation, angle, glm::vec3(0, 1, 0)); break;
                     case 'Z': modelRotation = glm::rotate(modelRotation, angle, glm::vec3(0, 0, 1)); break;
                 }
+                requestRedraw();
             }
             break;
         case GLFW_KEY_KP_SUBTRACT:
@@ -291,5 +352,150 @@ void handleInspectionKeys(int key) {
                     case 'Y': modelRotation = glm::rotate(modelRotation, angle, glm::vec3(0, 1, 0)); break;
                     case 'Z': modelRotation = glm::rotate(modelRotation, angle, glm::vec3(0, 0, 1)); break;
                 }
+                requestRedraw();
             }
             break;}}
+
+
+// Console commands (console.h). They run on the render thread between
+// frames, like the key handlers, and work in either mode.
+namespace {
+
+bool parseFloats(const std::vector<std::string>& words, size_t first, size_t count, float* out) {
+    if (words.size() != first + count) return false;
+    for (size_t i = 0; i < count; ++i) {
+        char* end = nullptr;
+        out[i] = std::strtof(words[first + i].c_str(), &end);
+        if (end == words[first + i].c_str() || *end != '\0') return false;
+    }
+    return true;
+}
+
+void printCommands() {
+    std::cout << "Commands:\n"
+              << "  color R G B            color of the selected node (0-1)\n"
+              << "  save FILE              .mod for text, .modb for binary\n"
+              << "  load FILE\n"
+              << "  add TYPE [LEVEL]       sphere, cone, box, cylinder or icosphere, as a\n"
+              << "                         child of the selected node, which it selects\n"
+              << "  select ID|parent|child|root\n"
+              << "  translate X Y Z        moves the selected node\n"
+              << "  rotate X|Y|Z DEGREES   turns it around one of its axes\n"
+              << "  scale X Y Z            multiplies its scale\n"
+              << "  level N                tessellation level 1-6\n"
+              << "  remove [subtree]       the selected node; children move up unless subtree\n";
+}
+
+} // namespace
+
+void runCommand(const console_command_t& command) {
+    static const char* const NAMES[] = {"help", "color", "save", "load", "add", "select", "translate",
+                                        "rotate", "scale", "level", "remove"};
+    std::vector<std::string> words = command.words;
+    bool known = std::find(std::begin(NAMES), std::end(NAMES), words[0]) != std::end(NAMES);
+    if (!known && !promptedCommand.empty()) words.insert(words.begin(), promptedCommand);
+    promptedCommand.clear();
+
+    const std::string& name = words[0];
+    model_node_t* node = getCurrentNode();
+    float v[3];
+
+    if (name == "help") {
+        printCommands();
+    } else if (name == "color") {
+        if (!parseFloats(words, 1, 3, v)) {
+            std::cout << "Usage: color R G B\n";
+        } else if (shape_t* shape = getCurrentShape()) {
+            shape->setColor(glm::vec4(v[0], v[1], v[2], 1.0f));
+            node->color = shape->color; // what save() writes
+        } else {
+            std::cout << "No shape selected!\n";
+        }
+    } else if (name == "save") {
+        if (words.size() != 2) {
+            std::cout << "Usage: save FILE\n";
+            return;
+        }
+        std::string filename = words[1];
+        if (filename.find(".mod") == std::string::npos) {
+            filename += ".mod";
+        }
+        currentModel->save(filename);
+    } else if (name == "load") {
+        if (words.size() != 2) {
+            std::cout << "Usage: load FILE\n";
+        } else if (currentModel->load(words[1])) {
+            currentNode = currentModel->getLastNode();
+            // Reset camera to view loaded model
+            cameraDistance = 5.0f;
+            cameraAngleX = 0.0f;
+            cameraAngleY = 0.0f;
+            modelRotation = glm::mat4(1.0f);
+            requestRedraw();
+        }
+    } else if (name == "add") {
+        int type = 0;
+        while (type < SHAPE_TYPE_COUNT && words.size() > 1 && words[1] != shapeTypeName(type)) ++type;
+        int level = words.size() == 3 ? std::atoi(words[2].c_str()) : 1;
+        if (words.size() < 2 || words.size() > 3 || type == SHAPE_TYPE_COUNT || level < 1 || level > 6) {
+            std::cout << "Usage: add sphere|cone|box|cylinder|icosphere [LEVEL 1-6]\n";
+            return;
+        }
+        int parent = node ? node->id : 0;
+        currentModel->addShapeToParent(parent, makeShape(static_cast<ShapeType>(type), level));
+        currentNode = currentModel->getLastNode();
+        std::cout << "Added " << words[1] << " " << currentModel->getNode(currentNode)->id << "\n";
+    } else if (name == "select") {
+        node_handle_t h;
+        if (words.size() == 2) {
+            if (words[1] == "parent") h = currentModel->getParent(currentNode);
+            else if (words[1] == "child") h = currentModel->getFirstChild(currentNode);
+            else if (words[1] == "root") h = currentModel->getRoot();
+            else h = currentModel->findMNodeById(std::atoi(words[1].c_str()));
+        }
+        if (!h.isValid()) {
+            std::cout << "No such node\n";
+            return;
+        }
+        currentNode = h;
+        std::cout << "Selected node " << currentModel->getNode(h)->id << "\n";
+    } else if (name == "translate" || name == "scale") {
+        if (!parseFloats(words, 1, 3, v)) {
+            std::cout << "Usage: " << name << " X Y Z\n";
+        } else if (node) {
+            if (name == "translate") node->translation += glm::vec3(v[0], v[1], v[2]);
+            else node->scale *= glm::vec3(v[0], v[1], v[2]);
+            currentModel->markDirty(currentNode);
+        }
+    } else if (name == "rotate") {
+        const char* axes = "XYZxyz";
+        const char* axis = words.size() == 3 && words[1].size() == 1 ? std::strchr(axes, words[1][0]) : nullptr;
+        if (!axis || !parseFloats(words, 2, 1, v)) {
+            std::cout << "Usage: rotate X|Y|Z DEGREES\n";
+        } else if (node) {
+            glm::vec3 a(0.0f);
+            a[(axis - axes) % 3] = 1.0f;
+            node->rotate(glm::radians(v[0]), a);
+            currentModel->markDirty(currentNode);
+        }
+    } else if (name == "level") {
+        int level = words.size() == 2 ? std::atoi(words[1].c_str()) : 0;
+        if (level < 1 || level > 6) std::cout << "Usage: level 1-6\n";
+        else if (shape_t* shape = getCurrentShape()) shape->setLevel(static_cast<unsigned int>(level));
+        else std::cout << "No shape selected!\n";
+    } else if (name == "remove") {
+        bool subtree = words.size() == 2 && words[1] == "subtree";
+        node_handle_t parent = currentModel->getParent(currentNode);
+        if (words.size() > 2 || (words.size() == 2 && !subtree)) {
+            std::cout << "Usage: remove [subtree]\n";
+        } else if (!node || !parent.isValid()) {
+            std::cout << "Cannot remove the root node.\n";
+        } else {
+            if (subtree) currentModel->removeSubtree(node->id);
+            else currentModel->removeNode(node->id);
+            currentNode = parent;
+        }
+    } else {
+        std::cout << "Unknown command: " << name << " (try help)\n";
+    }
+}
@@ -3,9 +3,14 @@
 
 #include <GLFW/glfw3.h>
 
+struct console_command_t;
+
 void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
 void handleModellingKeys(int key);
 void handleInspectionKeys(int key);
 void applyTransform(int direction);
+// Runs one console line; a bare line after the C, S or L key gets that
+// key's command
+void runCommand(const console_command_t& command);
 
 #endif
\ No newline at end of file
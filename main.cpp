@@ -6,112 +6,33 @@
 #include <iostream>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "shape.h"
 #include "input.h"
 #include "globals.h"
+#include "render.h"
 #include "HIERARCHIAL.h"
-
-
-glm::mat4 projection;
-glm::mat4 view;
-GLuint shaderProgram = 0;
-Mode currentMode = MODELLING;
-TransformMode transformMode = NONE;
-char activeAxis = 'X';
-std::shared_ptr<model_t> currentModel;
-std::shared_ptr<model_node_t> currentNode;
-float cameraDistance = 5.0f;
-float cameraAngleX = 0.0f;
-float cameraAngleY = 0.0f;
-glm::mat4 modelRotation = glm::mat4(1.0f);
-
-
-// Shader Creation
-GLuint createShaderProgram() {
-    const char* vertexShaderSrc = R"(
-    #version 330 core
-    layout(location = 0) in vec4 aPos;
-    layout(location = 1) in vec4 aColor;
-    uniform mat4 MVP;
-    out vec4 fragColor;
-    void main() {
-        gl_Position = MVP * aPos;
-        fragColor = aColor;
-    })";
-
-    const char* fragmentShaderSrc = R"(
-    #version 330 core
-    in vec4 fragColor;
-    out vec4 color;
-    void main() {
-        color = fragColor;
-    })";
-
-    GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader, 1, &vertexShaderSrc, nullptr);
-    glCompileShader(vertexShader);
-
-    GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, &fragmentShaderSrc, nullptr);
-    glCompileShader(fragmentShader);
-
-    GLuint program = glCreateProgram();
-    glAttachShader(program, vertexShader);
-    glAttachShader(program, fragmentShader);
-    glLinkProgram(program);
-
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
-
-    return program;
-}
-
-
-// Rendering Logic
-void renderNode(std::shared_ptr<model_node_t> node, const glm::mat4& parentTransform) {
-    if (!node) return;
-    glm::mat4 modelMatrix = parentTransform * node->getTransform();
-
-    if (node->shape) {
-        glm::mat4 MVP = projection * view * modelMatrix;
-        glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "MVP"),
-                           1, GL_FALSE, glm::value_ptr(MVP));
-        node->shape->draw(MVP, shaderProgram);
-    }
-
-    for (auto& child : node->children) {
-        renderNode(child, modelMatrix);
-    }
-}
-
-void renderScene() {
-    projection = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 100.0f);
-    
-    if (currentMode == INSPECTION) {
-        view = glm::lookAt(
-            glm::vec3(cameraDistance * sin(glm::radians(cameraAngleY)) * cos(glm::radians(cameraAngleX)),
-                      cameraDistance * sin(glm::radians(cameraAngleX)),
-                      cameraDistance * cos(glm::radians(cameraAngleY)) * cos(glm::radians(cameraAngleX))),
-            glm::vec3(0.0f, 0.0f, 0.0f),
-            glm::vec3(0.0f, 1.0f, 0.0f)
-        );
-        if (currentModel && currentModel->getRoot()) {
-            renderNode(currentModel->getRoot(), modelRotation);
-        }
-    } else {
-        view = glm::lookAt(glm::vec3(0.0f, 0.0f, 10.0f),
-                          glm::vec3(0.0f, 0.0f, 0.0f),
-                          glm::vec3(0.0f, 1.0f, 0.0f));
-        if (currentModel && currentModel->getRoot()) {
-            renderNode(currentModel->getRoot(), glm::mat4(1.0f));
+#include "mesh_builder.h"
+#include "console.h"
+
+
+// Main Application. --continuous draws every iteration instead of on
+// demand (K toggles it), for profiling and frame rate measurements.
+// Console commands are read from stdin, or with --command-pipe from a named
+// pipe that scripts can write to.
+int main(int argc, char** argv) {
+    std::string commandPipe;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--continuous") continuousRendering = true;
+        else if (arg == "--command-pipe" && i + 1 < argc) commandPipe = argv[++i];
+        else {
+            std::cerr << "Usage: modeller [--continuous] [--command-pipe PATH]\n";
+            return -1;
         }
     }
-}
 
-
-// Main Application
-int main() {
     if (!glfwInit()) {
         std::cerr << "Failed to initialize GLFW\n";
         return -1;
@@ -121,13 +42,16 @@ int main() {
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
-    GLFWwindow* window = glfwCreateWindow(800, 600, "Modeller", nullptr, nullptr);
+    GLFWwindow* window = glfwCreateWindow(viewportWidth, viewportHeight, "Modeller", nullptr, nullptr);
     if (!window) {
         std::cerr << "Failed to create window\n";
         glfwTerminate();
         return -1;
     }
     glfwMakeContextCurrent(window);
+    // The framebuffer is in pixels, which need not be the window's size in
+    // screen coordinates
+    glfwGetFramebufferSize(window, &viewportWidth, &viewportHeight);
 
     glewExperimental = GL_TRUE;
     if (glewInit() != GLEW_OK) {
@@ -135,30 +59,54 @@ int main() {
         return -1;
     }
 
-    glEnable(GL_DEPTH_TEST);
-
-    shaderProgram = createShaderProgram();
-    if (shaderProgram == 0) {
+    if (!initRenderer()) {
         std::cerr << "Failed to create shader program\n";
         return -1;
     }
     std::cout << "Shaders compiled and linked successfully!" << std::endl;
     
+    // Finished meshes wake the loop below so they get uploaded and drawn
+    mesh_builder_t::instance().setFinishedCallback(glfwPostEmptyEvent);
     currentModel = std::make_shared<model_t>();
     currentNode = currentModel->getRoot();
     glfwSetKeyCallback(window, keyCallback);
+    glfwSetWindowRefreshCallback(window, [](GLFWwindow*) { requestRedraw(); });
+    glfwSetFramebufferSizeCallback(window, [](GLFWwindow*, int width, int height) {
+        if (width == 0 || height == 0) return; // minimized; keep the last size
+        viewportWidth = width;
+        viewportHeight = height;
+        glViewport(0, 0, width, height);
+        requestRedraw();
+    });
+
+    console_t& console = console_t::instance();
+    console.setCommandCallback(glfwPostEmptyEvent);
+    if (!console.start(commandPipe)) {
+        mesh_builder_t::instance().setFinishedCallback(nullptr);
+        glfwTerminate();
+        return -1;
+    }
+    std::vector<console_command_t> commands;
 
+    // Nothing changed: sleep until an event instead of drawing the same frame
     while (!glfwWindowShouldClose(window)) {
-        glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        
-        glUseProgram(shaderProgram);
-        renderScene();
+        console.drain(commands);
+        for (const console_command_t& command : commands) runCommand(command);
+        if (!redrawNeeded()) {
+            glfwWaitEvents();
+            continue;
+        }
+        renderFrame();
         
         glfwSwapBuffers(window);
         glfwPollEvents();
     }
 
+    console.stop();
+    console.setCommandCallback(nullptr);
+    // Workers keep building past this point; from here on none of them is
+    // inside glfwPostEmptyEvent or can enter it
+    mesh_builder_t::instance().setFinishedCallback(nullptr);
     glfwDestroyWindow(window);
     glfwTerminate();
     return 0;
@@ -0,0 +1,228 @@
+#include "mesh_arena.h"
+#include <algorithm>
+#include <iterator>
+
+// Smallest pool sizes, in elements; pools are created by the first mesh
+// that needs one and double whenever they run out
+constexpr uint32_t INITIAL_VERTICES = 1 << 16;
+constexpr uint32_t INITIAL_INDICES = 1 << 18;
+
+bool range_allocator_t::allocate(uint32_t count, uint32_t& offset) {
+    for (auto it = freeRanges.begin(); it != freeRanges.end(); ++it) {
+        if (it->second < count) continue;
+        offset = it->first;
+        uint32_t rest = it->second - count;
+        freeRanges.erase(it);
+        if (rest > 0) freeRanges[offset + count] = rest;
+        inUse += count;
+        return true;
+    }
+    return false;
+}
+
+void range_allocator_t::release(uint32_t offset, uint32_t count) {
+    if (count == 0) return;
+    inUse -= count;
+    auto next = freeRanges.lower_bound(offset);
+    if (next != freeRanges.end() && offset + count == next->first) {
+        count += next->second;
+        next = freeRanges.erase(next);
+    }
+    if (next != freeRanges.begin()) {
+        auto prev = std::prev(next);
+        if (prev->first + prev->second == offset) {
+            prev->second += count;
+            return;
+        }
+    }
+    freeRanges[offset] = count;
+}
+
+void range_allocator_t::grow(uint32_t newCapacity) {
+    if (newCapacity <= cap) return;
+    inUse += newCapacity - cap; // release() below takes it off again
+    release(cap, newCapacity - cap);
+    cap = newCapacity;
+}
+
+// Never destroyed: meshes may be released after static destruction starts,
+// and the GL objects go away with the context anyway
+mesh_arena_t& mesh_arena_t::instance() {
+    static mesh_arena_t* arena = new mesh_arena_t();
+    return *arena;
+}
+
+void mesh_arena_t::init() {
+    if (vao) return;
+    vertexPool.elementSize = sizeof(glm::vec3);
+    shortIndexPool.elementSize = sizeof(uint16_t);
+    wideIndexPool.elementSize = sizeof(uint32_t);
+
+    vao = makeVertexArray();
+    instanceBuffer = makeBuffer();
+    commandBuffer = makeBuffer();
+    attachInstances(0);
+}
+
+// Moves a pool into a buffer at least twice as large, taken from the buffer
+// pool. The old contents are copied on the GPU, so existing allocations keep
+// their offsets, and the old buffer goes back to the pool.
+void mesh_arena_t::grow(pool_t& pool, uint32_t minCapacity) {
+    uint32_t capacity = std::max(pool.ranges.capacity(), 1u);
+    while (capacity < minCapacity) capacity *= 2;
+    if (pool.storage.buffer && capacity == pool.ranges.capacity()) return;
+
+    gl_buffer_pool_t& buffers = gl_buffer_pool_t::instance();
+    pooled_buffer_t next = buffers.acquire(capacity * pool.elementSize);
+    if (pool.storage.buffer) {
+        glBindBuffer(GL_COPY_READ_BUFFER, pool.storage.buffer.get());
+        glBindBuffer(GL_COPY_WRITE_BUFFER, next.buffer.get());
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0,
+                            pool.ranges.capacity() * pool.elementSize);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+    buffers.recycle(std::move(pool.storage));
+    pool.storage = std::move(next);
+    pool.ranges.grow(static_cast<uint32_t>(pool.storage.bytes / pool.elementSize));
+
+    // The VAO refers to buffer objects, so point it at the new one
+    if (&pool == &vertexPool) attachVertices();
+    if ((&pool == &shortIndexPool && boundIndices == 0) || (&pool == &wideIndexPool && boundIndices == 1)) {
+        boundIndices = -1;
+    }
+}
+
+void mesh_arena_t::attachVertices() {
+    glBindVertexArray(vao.get());
+    glBindBuffer(GL_ARRAY_BUFFER, vertexPool.storage.buffer.get());
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
+    glEnableVertexAttribArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+// Model matrix at locations 2-5, color at 6 and the color-override flag at 7
+void mesh_arena_t::attachInstances(size_t first) {
+    glBindVertexArray(vao.get());
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer.get());
+
+    GLsizei stride = sizeof(instance_t);
+    size_t base = first * sizeof(instance_t);
+    for (int col = 0; col < 4; ++col) {
+        glVertexAttribPointer(2 + col, 4, GL_FLOAT, GL_FALSE, stride, (void*)(base + col * sizeof(glm::vec4)));
+        glEnableVertexAttribArray(2 + col);
+        glVertexAttribDivisor(2 + col, 1);
+    }
+    glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, stride, (void*)(base + offsetof(instance_t, color)));
+    glEnableVertexAttribArray(6);
+    glVertexAttribDivisor(6, 1);
+    glVertexAttribPointer(7, 1, GL_FLOAT, GL_FALSE, stride, (void*)(base + offsetof(instance_t, useColor)));
+    glEnableVertexAttribArray(7);
+    glVertexAttribDivisor(7, 1);
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+bool mesh_arena_t::allocate(const glm::vec3* vertices, size_t vertexCount,
+                            const void* indices, size_t indexCount, bool wideIndices,
+                            mesh_allocation_t& out) {
+    init();
+    pool_t& indexPool = wideIndices ? wideIndexPool : shortIndexPool;
+
+    uint32_t baseVertex, firstIndex;
+    uint32_t vcount = static_cast<uint32_t>(vertexCount);
+    uint32_t icount = static_cast<uint32_t>(indexCount);
+    if (!vertexPool.ranges.allocate(vcount, baseVertex)) {
+        grow(vertexPool, std::max(vertexPool.ranges.capacity() + vcount, INITIAL_VERTICES));
+        if (!vertexPool.ranges.allocate(vcount, baseVertex)) return false;
+    }
+    if (!indexPool.ranges.allocate(icount, firstIndex)) {
+        grow(indexPool, std::max(indexPool.ranges.capacity() + icount, INITIAL_INDICES));
+        if (!indexPool.ranges.allocate(icount, firstIndex)) {
+            vertexPool.ranges.release(baseVertex, vcount);
+            return false;
+        }
+    }
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, vertexPool.storage.buffer.get());
+    glBufferSubData(GL_COPY_WRITE_BUFFER, baseVertex * sizeof(glm::vec3), vertexCount * sizeof(glm::vec3), vertices);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, indexPool.storage.buffer.get());
+    glBufferSubData(GL_COPY_WRITE_BUFFER, firstIndex * indexPool.elementSize, indexCount * indexPool.elementSize, indices);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    out.baseVertex = baseVertex;
+    out.vertexCount = vcount;
+    out.firstIndex = firstIndex;
+    out.indexCount = icount;
+    out.wideIndices = wideIndices;
+    out.valid = true;
+    return true;
+}
+
+void mesh_arena_t::release(mesh_allocation_t& allocation) {
+    if (!allocation.valid) return;
+    vertexPool.ranges.release(allocation.baseVertex, allocation.vertexCount);
+    pool_t& indexPool = allocation.wideIndices ? wideIndexPool : shortIndexPool;
+    indexPool.ranges.release(allocation.firstIndex, allocation.indexCount);
+    allocation.valid = false;
+}
+
+void mesh_arena_t::bind(bool wideIndices) {
+    init();
+    glBindVertexArray(vao.get());
+    // The element buffer binding is VAO state, so it only changes with the width
+    int wanted = wideIndices ? 1 : 0;
+    if (boundIndices != wanted) {
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, (wideIndices ? wideIndexPool : shortIndexPool).storage.buffer.get());
+        boundIndices = wanted;
+    }
+}
+
+GLuint mesh_arena_t::vertexArray() {
+    init();
+    return vao.get();
+}
+
+void mesh_arena_t::drawElements(const mesh_allocation_t& a) {
+    size_t indexSize = a.wideIndices ? sizeof(uint32_t) : sizeof(uint16_t);
+    glDrawElementsBaseVertex(GL_TRIANGLES, static_cast<GLsizei>(a.indexCount),
+                             a.wideIndices ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT,
+                             (void*)(a.firstIndex * indexSize), static_cast<GLint>(a.baseVertex));
+}
+
+void mesh_arena_t::uploadInstances(const instance_t* data, size_t count) {
+    init();
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer.get());
+    if (count > instanceCapacity) instanceCapacity = std::max(count, instanceCapacity * 2);
+    // Orphan last frame's storage instead of waiting for the GPU to finish with it
+    glBufferData(GL_ARRAY_BUFFER, instanceCapacity * sizeof(instance_t), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(instance_t), data);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void mesh_arena_t::setInstanceBase(size_t first) {
+    attachInstances(first);
+}
+
+void mesh_arena_t::uploadCommands(const draw_command_t* commands, size_t count) {
+    init();
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer.get());
+    if (count > commandCapacity) commandCapacity = std::max(count, commandCapacity * 2);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, commandCapacity * sizeof(draw_command_t), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, count * sizeof(draw_command_t), commands);
+}
+
+bool mesh_arena_t::hasMultiDrawIndirect() {
+    static const bool supported = GLEW_VERSION_4_3 || (GLEW_ARB_multi_draw_indirect && GLEW_ARB_base_instance);
+    return supported;
+}
+
+size_t mesh_arena_t::storageBytes() const {
+    return vertexPool.storage.bytes + shortIndexPool.storage.bytes + wideIndexPool.storage.bytes;
+}
+
+size_t mesh_arena_t::usedBytes() const {
+    return vertexPool.ranges.used() * vertexPool.elementSize +
+           shortIndexPool.ranges.used() * shortIndexPool.elementSize +
+           wideIndexPool.ranges.used() * wideIndexPool.elementSize;
+}
@@ -0,0 +1,112 @@
+#ifndef MESH_ARENA_H
+#define MESH_ARENA_H
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include "gl_resources.h"
+
+// One entry in the instance buffer: what a draw needs to know about its node
+struct instance_t {
+    glm::mat4 model;
+    glm::vec4 color;
+    float useColor;
+};
+
+// Layout GL expects in GL_DRAW_INDIRECT_BUFFER for glMultiDrawElementsIndirect
+struct draw_command_t {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+// Where a mesh lives inside the arena's shared buffers
+struct mesh_allocation_t {
+    uint32_t baseVertex = 0;
+    uint32_t vertexCount = 0;
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+    bool wideIndices = false; // 32-bit indices, in their own buffer
+    bool valid = false;
+};
+
+// First-fit allocator over [0, capacity); freed ranges merge with their
+// neighbours so the space can be handed out again
+class range_allocator_t {
+public:
+    bool allocate(uint32_t count, uint32_t& offset);
+    void release(uint32_t offset, uint32_t count);
+    void grow(uint32_t newCapacity);
+    uint32_t capacity() const { return cap; }
+    uint32_t used() const { return inUse; }
+
+private:
+    std::map<uint32_t, uint32_t> freeRanges; // offset -> count
+    uint32_t cap = 0;
+    uint32_t inUse = 0;
+};
+
+// All mesh geometry on the GPU: vertices, 16-bit indices and (only when a
+// mesh needs them) 32-bit indices are sub-allocated from one large buffer
+// each, behind a single VAO that also carries the per-instance attributes.
+// Drawing any mesh therefore never switches VAOs, and whole frames can be
+// submitted with one glMultiDrawElementsIndirect per index width.
+class mesh_arena_t {
+public:
+    static mesh_arena_t& instance();
+
+    // Copies a mesh into the shared buffers, growing them when needed
+    bool allocate(const glm::vec3* vertices, size_t vertexCount,
+                  const void* indices, size_t indexCount, bool wideIndices,
+                  mesh_allocation_t& out);
+    void release(mesh_allocation_t& allocation);
+
+    // Binds the shared VAO with the index buffer of the given width
+    void bind(bool wideIndices);
+    GLuint vertexArray();
+    // One plain draw of a single mesh (per-node path), after
+    // bind(allocation.wideIndices)
+    void drawElements(const mesh_allocation_t& allocation);
+
+    // Instance attributes for the next draws (locations 2-7, divisor 1)
+    void uploadInstances(const instance_t* data, size_t count);
+    // Points the instance attributes at instance `first`; only needed when
+    // draws cannot carry a baseInstance
+    void setInstanceBase(size_t first);
+    // Fills and binds GL_DRAW_INDIRECT_BUFFER
+    void uploadCommands(const draw_command_t* commands, size_t count);
+
+    // GL 4.3 / ARB_multi_draw_indirect with base instances
+    bool hasMultiDrawIndirect();
+
+    // GPU storage held for mesh geometry, and the part of it meshes occupy
+    size_t storageBytes() const;
+    size_t usedBytes() const;
+
+private:
+    struct pool_t {
+        pooled_buffer_t storage;
+        size_t elementSize = 0;
+        range_allocator_t ranges;
+    };
+
+    mesh_arena_t() = default;
+    void init();
+    void grow(pool_t& pool, uint32_t minCapacity);
+    void attachVertices();
+    void attachInstances(size_t first);
+
+    gl_vertex_array_t vao;
+    pool_t vertexPool, shortIndexPool, wideIndexPool;
+    gl_buffer_t instanceBuffer;
+    size_t instanceCapacity = 0;
+    gl_buffer_t commandBuffer;
+    size_t commandCapacity = 0;
+    int boundIndices = -1; // -1 none, 0 short, 1 wide
+};
+
+#endif
@@ -0,0 +1,119 @@
+#include "mesh_builder.h"
+#include "shape.h"
+#include <algorithm>
+#include <chrono>
+
+mesh_builder_t& mesh_builder_t::instance() {
+    static mesh_builder_t builder;
+    return builder;
+}
+
+// One core is left to the render thread
+mesh_builder_t::mesh_builder_t() {
+    unsigned int count = std::max(2u, std::thread::hardware_concurrency()) - 1;
+    for (unsigned int k = 0; k < count; ++k) workers.emplace_back(&mesh_builder_t::workerLoop, this);
+}
+
+// Queued jobs are dropped; jobs already running finish first
+mesh_builder_t::~mesh_builder_t() {
+    {
+        std::lock_guard<std::mutex> lock(jobsMutex);
+        stopping = true;
+        jobs.clear();
+    }
+    jobsReady.notify_all();
+    for (auto& w : workers) w.join();
+
+    finished_t* list = finished.exchange(nullptr);
+    while (list) {
+        finished_t* next = list->next;
+        delete list;
+        list = next;
+    }
+}
+
+void mesh_builder_t::submit(const std::shared_ptr<mesh_t>& mesh) {
+    outstanding.fetch_add(1, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(jobsMutex);
+        jobs.push_back(mesh);
+    }
+    jobsReady.notify_one();
+}
+
+void mesh_builder_t::submitBuilt(const std::shared_ptr<mesh_t>& mesh) {
+    outstanding.fetch_add(1, std::memory_order_relaxed);
+    publish(mesh);
+}
+
+void mesh_builder_t::workerLoop() {
+    for (;;) {
+        std::weak_ptr<mesh_t> job;
+        {
+            std::unique_lock<std::mutex> lock(jobsMutex);
+            jobsReady.wait(lock, [this] { return stopping || !jobs.empty(); });
+            if (stopping) return;
+            job = std::move(jobs.front());
+            jobs.pop_front();
+            ++busy;
+        }
+
+        // The strong reference is dropped before publishing: if this thread
+        // held the last one, the mesh dies here, before it could ever have
+        // been uploaded, so no GL call happens off the render thread
+        if (std::shared_ptr<mesh_t> mesh = job.lock()) mesh->build();
+        publish(std::move(job));
+
+        {
+            std::lock_guard<std::mutex> lock(jobsMutex);
+            --busy;
+            if (busy == 0 && jobs.empty()) jobsDone.notify_all();
+        }
+    }
+}
+
+void mesh_builder_t::publish(std::weak_ptr<mesh_t> mesh) {
+    finished_t* node = new finished_t{std::move(mesh), finished.load(std::memory_order_relaxed)};
+    while (!finished.compare_exchange_weak(node->next, node, std::memory_order_release,
+                                           std::memory_order_relaxed)) {}
+    std::lock_guard<std::mutex> lock(callbackMutex);
+    if (onFinished) onFinished();
+}
+
+void mesh_builder_t::setFinishedCallback(void (*callback)()) {
+    std::lock_guard<std::mutex> lock(callbackMutex);
+    onFinished = callback;
+}
+
+size_t mesh_builder_t::uploadFinished(double budgetMs) {
+    // Taking the whole stack at once leaves no ABA window; it comes out
+    // newest first, so flip it to keep uploads in submission order
+    finished_t* list = finished.exchange(nullptr, std::memory_order_acquire);
+    size_t start = uploadQueue.size();
+    while (list) {
+        uploadQueue.push_back(std::move(list->mesh));
+        finished_t* next = list->next;
+        delete list;
+        list = next;
+    }
+    std::reverse(uploadQueue.begin() + start, uploadQueue.end());
+
+    using clock = std::chrono::steady_clock;
+    auto begin = clock::now();
+    size_t uploaded = 0, taken = 0;
+    for (; taken < uploadQueue.size(); ++taken) {
+        if (uploaded > 0 && std::chrono::duration<double, std::milli>(clock::now() - begin).count() >= budgetMs) break;
+        if (std::shared_ptr<mesh_t> mesh = uploadQueue[taken].lock()) {
+            mesh->upload();
+            ++uploaded;
+        }
+    }
+    uploadQueue.erase(uploadQueue.begin(), uploadQueue.begin() + taken);
+    outstanding.fetch_sub(taken, std::memory_order_relaxed);
+    return uploaded;
+}
+
+void mesh_builder_t::waitIdle() {
+    std::unique_lock<std::mutex> lock(jobsMutex);
+    jobsDone.wait(lock, [this] { return jobs.empty() && busy == 0; });
+}
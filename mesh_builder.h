@@ -0,0 +1,79 @@
+#ifndef MESH_BUILDER_H
+#define MESH_BUILDER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct mesh_t;
+
+// Frame time the render thread may spend on mesh uploads, in milliseconds
+constexpr double MESH_UPLOAD_BUDGET_MS = 2.0;
+
+// Generates mesh geometry on worker threads, so creating or retessellating
+// shapes never generates geometry on the render thread. Workers hand
+// finished meshes back through a lock-free stack; the render thread drains
+// it in uploadFinished(), a few meshes per frame, and only then can the
+// meshes be drawn. Jobs hold weak references, so meshes nobody uses any
+// more are skipped instead of built.
+class mesh_builder_t {
+public:
+    static mesh_builder_t& instance();
+    ~mesh_builder_t();
+
+    mesh_builder_t(const mesh_builder_t&) = delete;
+    mesh_builder_t& operator=(const mesh_builder_t&) = delete;
+
+    // Queues a mesh for mesh_t::build() on a worker
+    void submit(const std::shared_ptr<mesh_t>& mesh);
+    // Queues a mesh that is already built for upload only
+    void submitBuilt(const std::shared_ptr<mesh_t>& mesh);
+    // Render thread only: uploads finished meshes until budgetMs has been
+    // spent (at least one per call); the rest wait for the next call.
+    // Returns the number uploaded.
+    size_t uploadFinished(double budgetMs);
+    // Blocks until every submitted mesh has been built (not uploaded)
+    void waitIdle();
+    // Meshes submitted but not uploaded yet
+    size_t pending() const { return outstanding.load(std::memory_order_relaxed); }
+    // Render thread only: finished meshes are waiting for uploadFinished()
+    bool uploadsWaiting() const {
+        return finished.load(std::memory_order_relaxed) != nullptr || !uploadQueue.empty();
+    }
+    // Called on a worker after each finished mesh, e.g. glfwPostEmptyEvent
+    // to wake a render loop sleeping in glfwWaitEvents(); nullptr for none.
+    // Waits for a call in progress, so once it returns the old callback is
+    // not running and never runs again.
+    void setFinishedCallback(void (*callback)());
+
+private:
+    mesh_builder_t();
+    void workerLoop();
+    void publish(std::weak_ptr<mesh_t> mesh);
+
+    struct finished_t {
+        std::weak_ptr<mesh_t> mesh;
+        finished_t* next;
+    };
+    // Pushed by the workers, taken as a whole by the render thread
+    std::atomic<finished_t*> finished{nullptr};
+    std::atomic<size_t> outstanding{0};
+    std::mutex callbackMutex; // held while onFinished runs
+    void (*onFinished)() = nullptr;
+    std::vector<std::weak_ptr<mesh_t>> uploadQueue; // render thread only
+
+    std::mutex jobsMutex;
+    std::condition_variable jobsReady;
+    std::condition_variable jobsDone;
+    std::deque<std::weak_ptr<mesh_t>> jobs;
+    size_t busy = 0;
+    bool stopping = false;
+    std::vector<std::thread> workers;
+};
+
+#endif
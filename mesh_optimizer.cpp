@@ -0,0 +1,159 @@
+#include "mesh_optimizer.h"
+#include <algorithm>
+#include <array>
+
+namespace {
+
+template <typename Index>
+float cacheMissRatio(const Index* indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize) {
+    if (indexCount < 3) return 0.0f;
+    // Miss number + 1 of each vertex's last load; 0 = never loaded
+    std::vector<size_t> loadedAt(vertexCount, 0);
+    size_t misses = 0;
+    for (size_t k = 0; k < indexCount; ++k) {
+        size_t& at = loadedAt[indices[k]];
+        if (at == 0 || at + cacheSize <= misses) at = ++misses;
+    }
+    return float(misses) / float(indexCount / 3);
+}
+
+} // namespace
+
+float analyzeVertexCache(const unsigned int* indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize) {
+    return cacheMissRatio(indices, indexCount, vertexCount, cacheSize);
+}
+
+float analyzeVertexCache(const uint16_t* indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize) {
+    return cacheMissRatio(indices, indexCount, vertexCount, cacheSize);
+}
+
+void removeDegenerateTriangles(const std::vector<glm::vec3>& vertices, std::vector<unsigned int>& indices) {
+    size_t triangleCount = indices.size() / 3;
+    std::vector<bool> keep(triangleCount, false);
+
+    // Rotated to start at its smallest index, a triangle compares equal to
+    // any copy with the same winding
+    std::vector<std::pair<std::array<unsigned int, 3>, size_t>> keys;
+    keys.reserve(triangleCount);
+    for (size_t t = 0; t < triangleCount; ++t) {
+        const unsigned int* tri = &indices[3 * t];
+        if (tri[0] == tri[1] || tri[1] == tri[2] || tri[0] == tri[2]) continue;
+        glm::vec3 normal = glm::cross(vertices[tri[1]] - vertices[tri[0]], vertices[tri[2]] - vertices[tri[0]]);
+        if (glm::dot(normal, normal) <= 1e-14f) continue;
+        int first = tri[0] < tri[1] ? (tri[0] < tri[2] ? 0 : 2) : (tri[1] < tri[2] ? 1 : 2);
+        keys.push_back({{tri[first], tri[(first + 1) % 3], tri[(first + 2) % 3]}, t});
+    }
+    std::sort(keys.begin(), keys.end());
+    for (size_t k = 0; k < keys.size(); ++k) {
+        if (k == 0 || keys[k].first != keys[k - 1].first) keep[keys[k].second] = true;
+    }
+
+    size_t count = 0;
+    for (size_t t = 0; t < triangleCount; ++t) {
+        if (!keep[t]) continue;
+        for (int c = 0; c < 3; ++c) indices[count++] = indices[3 * t + c];
+    }
+    indices.resize(count);
+}
+
+void optimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount, unsigned int cacheSize) {
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0 || vertexCount == 0) return;
+
+    // Triangles around each vertex, as offsets into one shared array
+    std::vector<unsigned int> live(vertexCount, 0);
+    for (unsigned int v : indices) ++live[v];
+    std::vector<size_t> adjacencyStart(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; ++v) adjacencyStart[v + 1] = adjacencyStart[v] + live[v];
+    std::vector<unsigned int> adjacency(indices.size());
+    {
+        std::vector<size_t> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+        for (size_t k = 0; k < indices.size(); ++k) adjacency[fill[indices[k]]++] = static_cast<unsigned int>(k / 3);
+    }
+
+    std::vector<uint64_t> cacheTime(vertexCount, 0);
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<unsigned int> deadEnd;  // recently used vertices, most recent last
+    std::vector<unsigned int> candidates;
+    std::vector<unsigned int> out;
+    out.reserve(indices.size());
+
+    uint64_t time = cacheSize + 1;
+    size_t cursor = 0;  // scan position for restarting on a fresh vertex
+    long fan = 0;       // vertex whose triangles are emitted next
+
+    while (fan >= 0) {
+        candidates.clear();
+        for (size_t a = adjacencyStart[fan]; a < adjacencyStart[fan + 1]; ++a) {
+            unsigned int t = adjacency[a];
+            if (emitted[t]) continue;
+            for (int c = 0; c < 3; ++c) {
+                unsigned int v = indices[t * 3 + c];
+                out.push_back(v);
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                --live[v];
+                if (time - cacheTime[v] > cacheSize) cacheTime[v] = time++;
+            }
+            emitted[t] = true;
+        }
+
+        // Next fan: the candidate that stays in the cache longest while its
+        // remaining triangles are emitted; otherwise back up through the
+        // dead-end stack, and finally scan for any vertex with work left
+        long best = -1;
+        uint64_t bestPriority = 0;
+        for (unsigned int v : candidates) {
+            if (live[v] == 0) continue;
+            uint64_t priority = 0;
+            if (time - cacheTime[v] + 2 * live[v] <= cacheSize) priority = time - cacheTime[v];
+            if (best < 0 || priority > bestPriority) {
+                best = v;
+                bestPriority = priority;
+            }
+        }
+        while (best < 0 && !deadEnd.empty()) {
+            unsigned int v = deadEnd.back();
+            deadEnd.pop_back();
+            if (live[v] > 0) best = v;
+        }
+        while (best < 0 && cursor < vertexCount) {
+            if (live[cursor] > 0) best = static_cast<long>(cursor);
+            ++cursor;
+        }
+        fan = best;
+    }
+
+    indices.swap(out);
+}
+
+void optimizeVertexFetch(std::vector<glm::vec3>& vertices, std::vector<unsigned int>& indices) {
+    const unsigned int unused = ~0u;
+    std::vector<unsigned int> remap(vertices.size(), unused);
+    std::vector<glm::vec3> ordered;
+    ordered.reserve(vertices.size());
+    for (unsigned int& v : indices) {
+        if (remap[v] == unused) {
+            remap[v] = static_cast<unsigned int>(ordered.size());
+            ordered.push_back(vertices[v]);
+        }
+        v = remap[v];
+    }
+    vertices.swap(ordered);
+}
+
+mesh_optimize_stats_t optimizeMesh(std::vector<glm::vec3>& vertices, std::vector<unsigned int>& indices) {
+    mesh_optimize_stats_t stats;
+    stats.verticesBefore = vertices.size();
+    stats.trianglesBefore = indices.size() / 3;
+    stats.acmrBefore = analyzeVertexCache(indices.data(), indices.size(), vertices.size());
+
+    removeDegenerateTriangles(vertices, indices);
+    optimizeVertexCache(indices, vertices.size());
+    optimizeVertexFetch(vertices, indices);
+
+    stats.verticesAfter = vertices.size();
+    stats.trianglesAfter = indices.size() / 3;
+    stats.acmrAfter = analyzeVertexCache(indices.data(), indices.size(), vertices.size());
+    return stats;
+}
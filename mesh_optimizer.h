@@ -0,0 +1,42 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Post-transform vertex cache size the orderings below aim at
+constexpr unsigned int VERTEX_CACHE_SIZE = 16;
+
+struct mesh_optimize_stats_t {
+    size_t verticesBefore = 0, verticesAfter = 0;
+    size_t trianglesBefore = 0, trianglesAfter = 0;
+    float acmrBefore = 0.0f, acmrAfter = 0.0f;
+};
+
+// Average cache miss ratio: vertex shader runs per triangle with a FIFO
+// cache of cacheSize entries. 0.5 is the ideal for large closed meshes.
+float analyzeVertexCache(const unsigned int* indices, size_t indexCount, size_t vertexCount,
+                         unsigned int cacheSize = VERTEX_CACHE_SIZE);
+float analyzeVertexCache(const uint16_t* indices, size_t indexCount, size_t vertexCount,
+                         unsigned int cacheSize = VERTEX_CACHE_SIZE);
+
+// Drops triangles that repeat a vertex, have no area, or repeat an earlier
+// triangle with the same winding
+void removeDegenerateTriangles(const std::vector<glm::vec3>& vertices, std::vector<unsigned int>& indices);
+
+// Reorders triangles so consecutive ones reuse recently transformed
+// vertices (Tipsify, Sander et al. 2007). Runs in linear time.
+void optimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount,
+                         unsigned int cacheSize = VERTEX_CACHE_SIZE);
+
+// Renumbers vertices in the order the index buffer first uses them, so
+// vertex fetches walk memory forwards; unreferenced vertices are dropped
+void optimizeVertexFetch(std::vector<glm::vec3>& vertices, std::vector<unsigned int>& indices);
+
+// All of the above, in order. Run on every mesh generated at run time; the
+// tables in mesh_tables.cpp are emitted in this form to begin with.
+mesh_optimize_stats_t optimizeMesh(std::vector<glm::vec3>& vertices, std::vector<unsigned int>& indices);
+
+#endif
@@ -0,0 +1,286 @@
+#include "mesh_tables.h"
+
+// Everything in this namespace runs at compile time. The generators emit
+// meshes in the form optimizeMesh() leaves them: no degenerate or repeated
+// triangles, triangles in vertex cache order and vertices numbered in order
+// of first use. The numbering is checked below; the miss ratios are
+// compared with what optimizeMesh() makes of each table by the "tables"
+// group of modeller_microbench. Running the optimizer itself in constexpr
+// would add tens of seconds to the build.
+namespace {
+
+constexpr double PI = 3.14159265358979323846;
+
+template <unsigned V, unsigned I>
+struct mesh_data_t {
+    table_vertex_t vertices[V]{};
+    uint16_t indices[I]{};
+    static constexpr unsigned vertexCount = V;
+    static constexpr unsigned indexCount = I;
+    static_assert(V <= 0x10000, "table meshes use 16-bit indices");
+};
+
+// Taylor series; the steps below are at most pi/10, where a dozen terms
+// reach double precision
+constexpr double sinStep(double x) {
+    double term = x, sum = x;
+    for (int k = 1; k < 12; ++k) {
+        term *= -x * x / ((2 * k) * (2 * k + 1));
+        sum += term;
+    }
+    return sum;
+}
+
+constexpr double cosStep(double x) {
+    double term = 1.0, sum = 1.0;
+    for (int k = 1; k < 12; ++k) {
+        term *= -x * x / ((2 * k - 1) * (2 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+// cos/sin of range * i / N for i = 0..N, by rotating a unit vector in double
+// precision. A full turn ends exactly on its first entry, so seams close.
+template <unsigned N>
+struct angle_table_t {
+    float cosines[N + 1]{};
+    float sines[N + 1]{};
+};
+
+template <unsigned N>
+constexpr angle_table_t<N> angleTable(double range) {
+    angle_table_t<N> t{};
+    double cs = cosStep(range / N), sn = sinStep(range / N);
+    double c = 1.0, s = 0.0;
+    for (unsigned i = 0; i <= N; ++i) {
+        t.cosines[i] = static_cast<float>(c);
+        t.sines[i] = static_cast<float>(s);
+        double next = c * cs - s * sn;
+        s = s * cs + c * sn;
+        c = next;
+    }
+    if (range == 2.0 * PI) {
+        t.cosines[N] = t.cosines[0];
+        t.sines[N] = t.sines[0];
+    }
+    return t;
+}
+
+// Quads are emitted in columns of sphereStripWidth() (mesh_tables.h). The
+// seam column and the pole rows are shared vertices, and the pole rows have
+// one triangle per quad instead of a degenerate pair.
+template <unsigned L>
+constexpr auto sphere() {
+    constexpr unsigned stacks = 10 * L;
+    constexpr unsigned slices = 10 * L;
+    mesh_data_t<(stacks - 1) * slices + 2, 6 * (stacks - 1) * slices> m{};
+    angle_table_t<stacks> phi = angleTable<stacks>(PI);
+    angle_table_t<slices> theta = angleTable<slices>(2.0 * PI);
+
+    constexpr uint16_t none = 0xFFFF;
+    uint16_t numbered[(stacks + 1) * slices]{};
+    for (uint16_t& n : numbered) n = none;
+    unsigned v = 0, k = 0;
+    auto emit = [&](unsigned i, unsigned j) {
+        j = (i == 0 || i == stacks) ? 0 : j % slices;
+        uint16_t& n = numbered[i * slices + j];
+        if (n == none) {
+            float ring = phi.sines[i];
+            m.vertices[v] = {ring * theta.cosines[j], phi.cosines[i], ring * theta.sines[j]};
+            n = static_cast<uint16_t>(v++);
+        }
+        m.indices[k++] = n;
+    };
+
+    constexpr unsigned width = sphereStripWidth(slices);
+    for (unsigned start = 0; start < slices; start += width) {
+        unsigned end = start + width < slices ? start + width : slices;
+        for (unsigned i = 0; i < stacks; ++i) {
+            for (unsigned j = start; j < end; ++j) {
+                if (i > 0) {
+                    emit(i, j);
+                    emit(i + 1, j);
+                    emit(i, j + 1);
+                }
+                if (i + 1 < stacks) {
+                    emit(i + 1, j);
+                    emit(i + 1, j + 1);
+                    emit(i, j + 1);
+                }
+            }
+        }
+    }
+    return m;
+}
+
+// Side and base triangles alternate, so each rim vertex is fetched once
+template <unsigned L>
+constexpr auto cone() {
+    constexpr unsigned slices = 20 * L;
+    mesh_data_t<slices + 2, slices * 6> m{};
+    angle_table_t<slices> theta = angleTable<slices>(2.0 * PI);
+
+    // Source vertices: 0 the apex, 1 the base center, 2 + i the rim
+    constexpr uint16_t none = 0xFFFF;
+    uint16_t numbered[slices + 2]{};
+    for (uint16_t& n : numbered) n = none;
+    unsigned v = 0, k = 0;
+    auto emit = [&](unsigned source) {
+        uint16_t& n = numbered[source];
+        if (n == none) {
+            unsigned i = source - 2;
+            m.vertices[v] = source == 0 ? table_vertex_t{0, 1, 0}
+                          : source == 1 ? table_vertex_t{0, -1, 0}
+                          : table_vertex_t{theta.cosines[i], -1, theta.sines[i]};
+            n = static_cast<uint16_t>(v++);
+        }
+        m.indices[k++] = n;
+    };
+
+    for (unsigned i = 0; i < slices; ++i) {
+        unsigned curr = 2 + i;
+        unsigned next = 2 + (i + 1) % slices;
+        emit(0);
+        emit(curr);
+        emit(next);
+
+        emit(1);
+        emit(next);
+        emit(curr);
+    }
+    return m;
+}
+
+// One (n+1) x (n+1) grid spanning origin - (u + w) .. origin + (u + w), in
+// row order. A row has at most 7 vertices, so two rows stay in the cache.
+template <typename M>
+constexpr void addFace(M& m, unsigned& v, unsigned& k, unsigned n,
+                       table_vertex_t origin, table_vertex_t u, table_vertex_t w) {
+    constexpr uint16_t none = 0xFFFF;
+    uint16_t numbered[7 * 7]{};
+    for (uint16_t& x : numbered) x = none;
+    auto emit = [&](unsigned i, unsigned j) {
+        uint16_t& x = numbered[i * (n + 1) + j];
+        if (x == none) {
+            float a = float(i) / n, b = float(j) / n;
+            m.vertices[v] = {origin.x + u.x * a * 2.0f + w.x * b * 2.0f - (u.x + w.x),
+                             origin.y + u.y * a * 2.0f + w.y * b * 2.0f - (u.y + w.y),
+                             origin.z + u.z * a * 2.0f + w.z * b * 2.0f - (u.z + w.z)};
+            x = static_cast<uint16_t>(v++);
+        }
+        m.indices[k++] = x;
+    };
+
+    for (unsigned i = 0; i < n; ++i) {
+        for (unsigned j = 0; j < n; ++j) {
+            emit(i, j);
+            emit(i + 1, j);
+            emit(i, j + 1);
+
+            emit(i + 1, j);
+            emit(i + 1, j + 1);
+            emit(i, j + 1);
+        }
+    }
+}
+
+template <unsigned L>
+constexpr auto box() {
+    constexpr unsigned n = L; // subdivisions per edge
+    static_assert(n <= 6, "addFace() numbers at most 7 x 7 vertices");
+    mesh_data_t<6 * (n + 1) * (n + 1), 36 * n * n> m{};
+    unsigned v = 0, k = 0;
+    addFace(m, v, k, n, {-1, -1, -1}, {2, 0, 0}, {0, 2, 0}); // back
+    addFace(m, v, k, n, {-1, -1,  1}, {2, 0, 0}, {0, 2, 0}); // front
+    addFace(m, v, k, n, {-1, -1, -1}, {0, 0, 2}, {0, 2, 0}); // left
+    addFace(m, v, k, n, { 1, -1, -1}, {0, 0, 2}, {0, 2, 0}); // right
+    addFace(m, v, k, n, {-1,  1, -1}, {2, 0, 0}, {0, 0, 2}); // top
+    addFace(m, v, k, n, {-1, -1, -1}, {2, 0, 0}, {0, 0, 2}); // bottom
+    return m;
+}
+
+template <unsigned L>
+constexpr auto cylinder() {
+    constexpr unsigned slices = 20 * L;
+    mesh_data_t<2 * slices, slices * 6> m{};
+    angle_table_t<slices> theta = angleTable<slices>(2.0 * PI);
+
+    for (unsigned i = 0; i < slices; ++i) {
+        m.vertices[2 * i] = {theta.cosines[i], 1, theta.sines[i]};      // top (even index)
+        m.vertices[2 * i + 1] = {theta.cosines[i], -1, theta.sines[i]}; // bottom (odd index)
+    }
+
+    unsigned k = 0;
+    for (unsigned i = 0; i < slices; ++i) {
+        uint16_t curr = static_cast<uint16_t>(i * 2);
+        uint16_t next = static_cast<uint16_t>(((i + 1) % slices) * 2);
+
+        m.indices[k++] = curr;
+        m.indices[k++] = curr + 1;
+        m.indices[k++] = next;
+
+        m.indices[k++] = curr + 1;
+        m.indices[k++] = next + 1;
+        m.indices[k++] = next;
+    }
+    return m;
+}
+
+// Every index is at most one past the highest before it, and every vertex
+// is used
+template <typename M>
+constexpr bool inFirstUseOrder(const M& m) {
+    unsigned next = 0;
+    for (uint16_t i : m.indices) {
+        if (i > next) return false;
+        if (i == next) ++next;
+    }
+    return next == M::vertexCount;
+}
+
+template <unsigned L>
+struct level_tables_t {
+    static constexpr auto sphereMesh = sphere<L>();
+    static constexpr auto coneMesh = cone<L>();
+    static constexpr auto boxMesh = box<L>();
+    static constexpr auto cylinderMesh = cylinder<L>();
+    static_assert(inFirstUseOrder(sphereMesh) && inFirstUseOrder(coneMesh) &&
+                  inFirstUseOrder(boxMesh) && inFirstUseOrder(cylinderMesh),
+                  "table vertices must be numbered in order of first use");
+};
+
+template <typename M>
+constexpr unit_mesh_view_t view(const M& m) {
+    unit_mesh_view_t out{m.vertices, M::vertexCount, m.indices, M::indexCount, m.vertices[0], m.vertices[0]};
+    for (const table_vertex_t& v : m.vertices) {
+        out.lower = {v.x < out.lower.x ? v.x : out.lower.x, v.y < out.lower.y ? v.y : out.lower.y,
+                     v.z < out.lower.z ? v.z : out.lower.z};
+        out.upper = {v.x > out.upper.x ? v.x : out.upper.x, v.y > out.upper.y ? v.y : out.upper.y,
+                     v.z > out.upper.z ? v.z : out.upper.z};
+    }
+    return out;
+}
+
+// Rows follow ShapeType: sphere, cone, box, cylinder
+template <unsigned L>
+constexpr unit_mesh_view_t levelView(int type) {
+    return type == 0 ? view(level_tables_t<L>::sphereMesh)
+         : type == 1 ? view(level_tables_t<L>::coneMesh)
+         : type == 2 ? view(level_tables_t<L>::boxMesh)
+         : view(level_tables_t<L>::cylinderMesh);
+}
+
+constexpr unit_mesh_view_t unitMeshes[4][6] = {
+    {levelView<1>(0), levelView<2>(0), levelView<3>(0), levelView<4>(0), levelView<5>(0), levelView<6>(0)},
+    {levelView<1>(1), levelView<2>(1), levelView<3>(1), levelView<4>(1), levelView<5>(1), levelView<6>(1)},
+    {levelView<1>(2), levelView<2>(2), levelView<3>(2), levelView<4>(2), levelView<5>(2), levelView<6>(2)},
+    {levelView<1>(3), levelView<2>(3), levelView<3>(3), levelView<4>(3), levelView<5>(3), levelView<6>(3)},
+};
+
+} // namespace
+
+const unit_mesh_view_t* findUnitMesh(int type, unsigned int level) {
+    if (type < 0 || type > 3 || level < 1 || level > 6) return nullptr;
+    return &unitMeshes[type][level - 1];
+}
@@ -0,0 +1,39 @@
+#ifndef MESH_TABLES_H
+#define MESH_TABLES_H
+
+#include <cstdint>
+
+#include "mesh_optimizer.h"
+
+// Level 1-6 meshes of the four built-in primitives, generated by the
+// compiler (mesh_tables.cpp). The tables sit in read-only data, so creating
+// a primitive costs a lookup plus the GPU upload, and nothing is generated
+// at startup or while loading a model.
+
+// Same layout as glm::vec3
+struct table_vertex_t {
+    float x, y, z;
+};
+
+struct unit_mesh_view_t {
+    const table_vertex_t* vertices;
+    uint32_t vertexCount;
+    const uint16_t* indices;
+    uint32_t indexCount;
+    table_vertex_t lower, upper; // bounding box corners
+};
+
+// Sphere quads are emitted in columns this wide, row by row, so the two
+// rows of vertices in use stay in a VERTEX_CACHE_SIZE entry cache. A sphere
+// with no more slices than the cache holds is one column all the way round.
+// The procedural shader in render.cpp gets both constants as #defines.
+constexpr unsigned int SPHERE_STRIP_WIDTH = VERTEX_CACHE_SIZE / 2 - 1;
+
+constexpr unsigned int sphereStripWidth(unsigned int slices) {
+    return slices <= VERTEX_CACHE_SIZE ? slices : SPHERE_STRIP_WIDTH;
+}
+
+// Table for a ShapeType value and level 1-6; nullptr for anything else
+const unit_mesh_view_t* findUnitMesh(int type, unsigned int level);
+
+#endif
@@ -0,0 +1,297 @@
+// CPU microbenchmarks for the hot paths that do not need a GL context:
+// mesh creation, .mod/.modb save and load, id lookup and the transform
+// walk behind renderNodes(). Results are written as JSON for tracking
+// regressions between releases.
+//
+//   ./modeller_microbench --out microbench.json --max-nodes 1000000
+//
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "shape.h"
+#include "HIERARCHIAL.h"
+#include "mesh_optimizer.h"
+#include "mesh_tables.h"
+#include "synthetic_scene.h"
+#include "task_pool.h"
+
+namespace {
+
+struct bench_result_t {
+    std::string name;
+    size_t iterations = 0;
+    size_t items = 1;        // work items per iteration (vertices, nodes, lookups)
+    double meanNs = 0.0;
+    double medianNs = 0.0;
+    double minNs = 0.0;
+};
+
+std::vector<bench_result_t> results;
+double minSeconds = 0.3;
+// How much worse than optimizeMesh() a table's cache miss ratio may be
+const float TABLE_ACMR_TOLERANCE = 0.01f;
+
+// save()/load() report every file on std::cout; keep that out of the output
+struct quiet_cout_t {
+    std::streambuf* old = std::cout.rdbuf(nullptr);
+    ~quiet_cout_t() {
+        std::cout.rdbuf(old);
+        std::cout.clear();
+    }
+};
+
+// Runs fn until it has taken minSeconds (at least once), after one untimed
+// warm-up call
+template <typename F>
+void measure(const std::string& name, size_t items, F&& fn) {
+    fn();
+    std::vector<double> samples;
+    double total = 0.0;
+    while (samples.empty() || (total < minSeconds * 1e9 && samples.size() < 100000)) {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        samples.push_back(ns);
+        total += ns;
+    }
+    std::sort(samples.begin(), samples.end());
+
+    bench_result_t r;
+    r.name = name;
+    r.iterations = samples.size();
+    r.items = items;
+    r.meanNs = total / samples.size();
+    r.medianNs = samples[samples.size() / 2];
+    r.minNs = samples.front();
+    results.push_back(r);
+
+    std::printf("%-36s %8zu iters  %14.0f ns  %10.2f ns/item\n",
+                name.c_str(), r.iterations, r.medianNs, r.medianNs / std::max<size_t>(items, 1));
+}
+
+void buildScene(model_t& model, size_t nodes) {
+    synthetic_scene_t params;
+    params.nodes = nodes;
+    params.depth = 10;
+    quiet_cout_t quiet;
+    generateSyntheticModel(model, params);
+}
+
+// Everything it takes to get a primitive's geometry ready for upload
+void benchGeometry() {
+    for (int t = 0; t < SHAPE_TYPE_COUNT; ++t) {
+        for (unsigned int level = 1; level <= 6; ++level) {
+            ShapeType type = static_cast<ShapeType>(t);
+            mesh_t probe(type, level);
+            probe.build();
+            measure("buildMesh/" + std::string(shapeTypeName(t)) + "/" + std::to_string(level),
+                    probe.vertexCount(), [&] {
+                mesh_t mesh(type, level);
+                mesh.build();
+            });
+        }
+    }
+}
+
+// The compile-time tables claim to be in optimizeMesh() form already. Runs
+// each one through it and fails if the optimizer still finds triangles to
+// drop or a better vertex cache order; also times the run it saves.
+bool checkTables() {
+    bool ok = true;
+    for (int t = 0; t < SHAPE_TYPE_COUNT; ++t) {
+        for (unsigned int level = 1; level <= 6; ++level) {
+            const unit_mesh_view_t* table = findUnitMesh(t, level);
+            if (!table) continue;
+            std::vector<glm::vec3> vertices(table->vertexCount);
+            for (size_t i = 0; i < vertices.size(); ++i) {
+                vertices[i] = glm::vec3(table->vertices[i].x, table->vertices[i].y, table->vertices[i].z);
+            }
+            std::vector<unsigned int> indices(table->indices, table->indices + table->indexCount);
+
+            std::string name = "optimizeMesh/" + std::string(shapeTypeName(t)) + "/" + std::to_string(level);
+            mesh_optimize_stats_t stats;
+            measure(name, table->vertexCount, [&] {
+                std::vector<glm::vec3> v = vertices;
+                std::vector<unsigned int> i = indices;
+                stats = optimizeMesh(v, i);
+            });
+            bool same = stats.trianglesAfter == stats.trianglesBefore && stats.verticesAfter == stats.verticesBefore &&
+                        stats.acmrBefore <= stats.acmrAfter + TABLE_ACMR_TOLERANCE;
+            std::printf("  table ACMR %.3f, optimizer %.3f%s\n", stats.acmrBefore, stats.acmrAfter,
+                        same ? "" : "  <- table is not in optimizer form");
+            ok = ok && same;
+        }
+    }
+    return ok;
+}
+
+void benchSerialization(const std::vector<size_t>& sizes) {
+    std::filesystem::path dir = std::filesystem::temp_directory_path();
+    for (size_t n : sizes) {
+        model_t model;
+        buildScene(model, n);
+
+        for (const char* ext : {".mod", ".modb"}) {
+            std::string file = (dir / ("modeller_microbench_" + std::to_string(n) + ext)).string();
+            std::string format = ext[4] == 'b' ? "binary" : "text";
+            quiet_cout_t quiet;
+            measure("save/" + format + "/" + std::to_string(n), n, [&] { model.save(file); });
+            model_t loaded;
+            measure("load/" + format + "/" + std::to_string(n), n, [&] { loaded.load(file); });
+            std::remove(file.c_str());
+        }
+    }
+}
+
+void benchLookup(size_t n) {
+    model_t model;
+    buildScene(model, n);
+
+    // Ids are handed out in insertion order, so [0, n] all exist
+    const size_t lookups = 1 << 16;
+    std::vector<int> ids(lookups);
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> pick(0, static_cast<int>(n));
+    for (int& id : ids) id = pick(rng);
+
+    size_t found = 0;
+    measure("findMNodeById/" + std::to_string(n), lookups, [&] {
+        for (int id : ids) found += model.findMNodeById(id).isValid();
+    });
+    if (found == 0) std::printf("  (no ids found)\n");
+}
+
+// The per-node render path minus GL: refresh the cached matrices, then walk
+// the pool and gather the MVP uploads renderNodes() would issue
+void benchTraversal(size_t n) {
+    model_t model;
+    buildScene(model, n);
+
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 100.0f);
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, 10.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 VP = projection * view;
+    std::vector<glm::mat4> uploads;
+    uploads.reserve(n + 1);
+
+    auto walk = [&] {
+        uploads.clear();
+        for (const model_node_t& node : model.getNodes()) {
+            if (node.shape) uploads.push_back(node.mvpMatrix);
+        }
+    };
+
+    // Static scene: matrices stay cached, only the walk remains
+    model.updateTransforms(glm::mat4(1.0f), VP);
+    measure("traversal/static/" + std::to_string(n), n, [&] {
+        model.updateTransforms(glm::mat4(1.0f), VP);
+        walk();
+    });
+
+    // Rotating model: every world and MVP matrix is recomputed each frame
+    glm::mat4 rotation(1.0f);
+    measure("traversal/animated/" + std::to_string(n), n, [&] {
+        rotation = glm::rotate(rotation, glm::radians(1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        model.updateTransforms(rotation, VP);
+        walk();
+    });
+
+    // Every node turned: local matrices are recomposed as well
+    measure("traversal/edited/" + std::to_string(n), n, [&] {
+        for (uint32_t i = 1; i < model.getNodes().size(); ++i) {
+            node_handle_t h = model.handleOf(i);
+            model.getNode(h)->rotate(glm::radians(1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+            model.markDirty(h);
+        }
+        model.updateTransforms(rotation, VP);
+        walk();
+    });
+
+    // The render loop's draw list: frustum culling over the subtree bounds
+    std::vector<const model_node_t*> visible;
+    measure("traversal/visible/" + std::to_string(n), n, [&] {
+        model.collectVisible(VP, true, visible);
+    });
+}
+
+bool writeJson(const std::string& filename) {
+    std::ofstream out(filename);
+    if (!out.is_open()) return false;
+
+    char stamp[32];
+    std::time_t now = std::time(nullptr);
+    std::strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+    out << "{\n"
+        << "  \"suite\": \"modeller_microbench\",\n"
+        << "  \"timestamp\": \"" << stamp << "\",\n"
+        << "  \"compiler\": \"" << __VERSION__ << "\",\n"
+        << "  \"threads\": " << task_pool_t::instance().threadCount() << ",\n"
+        << "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const bench_result_t& r = results[i];
+        out << "    {\"name\": \"" << r.name << "\", \"iterations\": " << r.iterations
+            << ", \"items\": " << r.items
+            << ", \"mean_ns\": " << r.meanNs
+            << ", \"median_ns\": " << r.medianNs
+            << ", \"min_ns\": " << r.minNs << "}"
+            << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    out << "  ]\n}\n";
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string outFile = "microbench.json";
+    size_t maxNodes = 1000000;
+    std::string filter;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (arg == "--out" && value) outFile = argv[++i];
+        else if (arg == "--max-nodes" && value) maxNodes = std::strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--min-time" && value) minSeconds = std::atof(argv[++i]);
+        else if (arg == "--filter" && value) filter = argv[++i];
+        else {
+            std::cout << "Usage: modeller_microbench [--out FILE] [--max-nodes N] [--min-time SECONDS]\n"
+                      << "                           [--filter geometry|tables|serialization|lookup|traversal]\n";
+            return 1;
+        }
+    }
+
+    std::vector<size_t> sizes;
+    for (size_t n = 1000; n <= maxNodes; n *= 10) sizes.push_back(n);
+    size_t sceneNodes = std::min<size_t>(maxNodes, 100000);
+
+    auto enabled = [&](const char* group) { return filter.empty() || filter == group; };
+    if (enabled("geometry")) benchGeometry();
+    bool tablesOk = !enabled("tables") || checkTables();
+    if (enabled("serialization")) benchSerialization(sizes);
+    if (enabled("lookup")) benchLookup(sceneNodes);
+    if (enabled("traversal")) benchTraversal(sceneNodes);
+
+    if (!writeJson(outFile)) {
+        std::cerr << "Failed to write " << outFile << std::endl;
+        return 1;
+    }
+    std::cout << "Results written to " << outFile << std::endl;
+    if (!tablesOk) {
+        std::cerr << "Built-in mesh tables differ from optimizeMesh() output" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,150 @@
+#include "HIERARCHIAL.h"
+#include "model_binary.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+// Stored w first, independent of glm's member order
+void storeRotation(modb_node_t& r, const glm::quat& q) {
+    r.rotation[0] = q.w;
+    r.rotation[1] = q.x;
+    r.rotation[2] = q.y;
+    r.rotation[3] = q.z;
+}
+
+// A version 1 record in the current layout
+modb_node_t upgradeRecord(const modb_node_v1_t& old) {
+    modb_node_t r;
+    r.id = old.id;
+    r.parent = old.parent;
+    r.type = old.type;
+    r.level = old.level;
+    glm::vec3 translation = translationFromMatrix(old.translation);
+    glm::quat rotation = rotationFromMatrix(old.rotation);
+    glm::vec3 scale = scaleFromMatrix(old.scale);
+    std::memcpy(r.translation, glm::value_ptr(translation), sizeof(r.translation));
+    storeRotation(r, rotation);
+    std::memcpy(r.scale, glm::value_ptr(scale), sizeof(r.scale));
+    std::memcpy(r.color, old.color, sizeof(r.color));
+    return r;
+}
+
+} // namespace
+
+void model_t::saveBinary(const std::string& filename) {
+    std::ofstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        std::cout << "Failed to save model to " << filename << std::endl;
+        return;
+    }
+
+    // Pool index 0 is the root, which is not stored, so record = index - 1
+    ensureLayout();
+    std::vector<modb_node_t> table(nodes.size() - 1);
+    for (size_t i = 1; i < nodes.size(); ++i) {
+        const model_node_t& m = nodes[i];
+        modb_node_t& r = table[i - 1];
+        r.id = m.id;
+        r.parent = m.parent == 0 ? MODB_NO_PARENT : static_cast<int32_t>(m.parent) - 1;
+        r.type = static_cast<int32_t>(m.type);
+        r.level = m.shape ? m.shape->getLevel() : 1;
+        std::memcpy(r.translation, glm::value_ptr(m.translation), sizeof(r.translation));
+        storeRotation(r, m.rotation);
+        std::memcpy(r.scale, glm::value_ptr(m.scale), sizeof(r.scale));
+        std::memcpy(r.color, glm::value_ptr(m.color), sizeof(r.color));
+    }
+
+    modb_header_t header{};
+    std::memcpy(header.magic, MODB_MAGIC, sizeof(header.magic));
+    header.version = MODB_VERSION;
+    header.node_size = sizeof(modb_node_t);
+    header.node_count = static_cast<uint32_t>(table.size());
+    header.nodes_offset = sizeof(modb_header_t);
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(modb_node_t));
+    file.close();
+    std::cout << "Model saved to " << filename << std::endl;
+}
+
+bool model_t::loadBinary(const std::string& filename) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cout << "Failed to load model from " << filename << std::endl;
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(modb_header_t)) {
+        close(fd);
+        std::cout << "Not a valid model file: " << filename << std::endl;
+        return false;
+    }
+    size_t size = static_cast<size_t>(st.st_size);
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        std::cout << "Failed to map model file " << filename << std::endl;
+        return false;
+    }
+    madvise(mapped, size, MADV_SEQUENTIAL);
+
+    const char* base = static_cast<const char*>(mapped);
+    const modb_header_t* header = reinterpret_cast<const modb_header_t*>(base);
+    bool legacy = header->version == 1;
+    size_t recordSize = legacy ? sizeof(modb_node_v1_t) : sizeof(modb_node_t);
+    bool valid = std::equal(MODB_MAGIC, MODB_MAGIC + sizeof(MODB_MAGIC), header->magic) &&
+                 (legacy || header->version == MODB_VERSION) &&
+                 header->node_size == recordSize &&
+                 header->nodes_offset >= sizeof(modb_header_t) &&
+                 header->nodes_offset % alignof(modb_node_t) == 0 &&
+                 header->nodes_offset <= size &&
+                 (size - header->nodes_offset) / recordSize >= header->node_count;
+    if (!valid) {
+        munmap(mapped, size);
+        std::cout << "Unsupported or corrupt model file: " << filename << std::endl;
+        return false;
+    }
+
+    // The node table is read straight out of the mapping
+    const modb_node_t* table = reinterpret_cast<const modb_node_t*>(base + header->nodes_offset);
+    const modb_node_v1_t* legacyTable = reinterpret_cast<const modb_node_v1_t*>(base + header->nodes_offset);
+    uint32_t count = header->node_count;
+
+    clear();
+    nodes.reserve(count + 1);
+    slots.reserve(count + 1);
+    added.reserve(count + 1);
+    id_index.reserve(count + 1);
+    for (uint32_t i = 0; i < count; ++i) {
+        const modb_node_t r = legacy ? upgradeRecord(legacyTable[i]) : table[i];
+        // Parents always come first; anything else attaches to the root
+        uint32_t parent = 0;
+        if (r.parent >= 0 && static_cast<uint32_t>(r.parent) < i) parent = static_cast<uint32_t>(r.parent) + 1;
+
+        ShapeType type = static_cast<ShapeType>(std::clamp(r.type, 0, static_cast<int32_t>(ICOSPHERE_SHAPE)));
+        std::unique_ptr<shape_t> s = makeShape(type, r.level);
+        glm::vec4 color;
+        std::memcpy(glm::value_ptr(color), r.color, sizeof(r.color));
+        s->setColor(color);
+
+        model_node_t* node = getNode(createNode(std::move(s), parent, r.id));
+        node->color = color;
+        std::memcpy(glm::value_ptr(node->translation), r.translation, sizeof(r.translation));
+        node->rotation = glm::normalize(glm::quat(r.rotation[0], r.rotation[1], r.rotation[2], r.rotation[3]));
+        std::memcpy(glm::value_ptr(node->scale), r.scale, sizeof(r.scale));
+    }
+    munmap(mapped, size);
+
+    // The root covers every loaded node
+    dirty_roots.assign(1, getRoot());
+    std::cout << "Model loaded from " << filename << std::endl;
+    return true;
+}
@@ -0,0 +1,65 @@
+#ifndef MODEL_BINARY_H
+#define MODEL_BINARY_H
+
+#include <cstdint>
+#include <string>
+
+// Binary model format (.modb)
+//
+// A fixed header followed by one packed record per node, with no strings,
+// so a loader can mmap the file and read the node table in place. Header
+// and records are the structs below as the host lays them out, with no byte
+// swapping; files are little-endian because only little-endian hosts can
+// build this. Records are written in depth-first order and refer to their
+// parent by record index, which always points backwards.
+//
+// Version 1 records held the transform as three 4x4 matrices; those files
+// are still read and converted on load.
+
+constexpr char MODB_MAGIC[4] = {'M', 'O', 'D', 'B'};
+constexpr uint32_t MODB_VERSION = 2;
+constexpr int32_t MODB_NO_PARENT = -1; // child of the root node
+
+struct modb_header_t {
+    char magic[4];
+    uint32_t version;
+    uint32_t node_size;    // sizeof(modb_node_t) at write time
+    uint32_t node_count;
+    uint64_t nodes_offset; // byte offset of the node table
+};
+
+struct modb_node_t {
+    int32_t id;
+    int32_t parent;        // record index, or MODB_NO_PARENT
+    int32_t type;          // ShapeType
+    uint32_t level;        // tesselation level
+    float translation[3];
+    float rotation[4];     // normalized quaternion, w x y z
+    float scale[3];
+    float color[4];
+};
+
+struct modb_node_v1_t {
+    int32_t id;
+    int32_t parent;
+    int32_t type;
+    uint32_t level;
+    float translation[16]; // column-major, as glm stores them
+    float rotation[16];
+    float scale[16];
+    float color[4];
+};
+
+// Reading records in place rules out byte swapping on big-endian hosts
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "modb files are little-endian");
+static_assert(sizeof(modb_header_t) == 24, "modb header must stay packed");
+static_assert(sizeof(modb_node_t) == 72, "modb node record must stay packed");
+static_assert(sizeof(modb_node_v1_t) == 224, "modb version 1 record must stay packed");
+
+inline bool isBinaryModelName(const std::string& filename) {
+    const std::string ext = ".modb";
+    return filename.size() >= ext.size() &&
+           filename.compare(filename.size() - ext.size(), ext.size(), ext) == 0;
+}
+
+#endif
@@ -0,0 +1,211 @@
+#include "HIERARCHIAL.h"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// Reader for the text .mod format written by model_t::save().
+//
+// The whole file is read into one buffer, cut into chunks that each start on
+// a "SHAPE" record, and the chunks are parsed on separate threads with
+// std::from_chars (no streams, no locale, no seeking). Linking the parsed
+// records into the hierarchy is a single linear pass at the end.
+
+namespace {
+
+struct text_entry_t {
+    int id = 0;
+    ShapeType type = SPHERE_SHAPE;
+    glm::vec3 translation{0.0f};
+    glm::quat rotation{1.0f, 0.0f, 0.0f, 0.0f};
+    glm::vec3 scale{1.0f};
+    int parent_id = -1;
+    glm::vec4 color{1.0f};
+};
+
+// Below this size a single thread is faster than spinning up workers
+constexpr size_t PARALLEL_PARSE_MIN_BYTES = 1 << 20;
+// Larger files are refused rather than read into one buffer
+constexpr size_t MAX_TEXT_MODEL_BYTES = size_t(1) << 32;
+
+inline bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+class line_parser_t {
+public:
+    line_parser_t(const char* begin, const char* end) : p(begin), end(end) {}
+
+    std::string_view keyword() {
+        skipSpace();
+        const char* start = p;
+        while (p < end && !isSpace(*p)) ++p;
+        return std::string_view(start, p - start);
+    }
+
+    template <typename T>
+    bool number(T& value) {
+        skipSpace();
+        auto result = std::from_chars(p, end, value);
+        if (result.ec != std::errc()) return false;
+        p = result.ptr;
+        return true;
+    }
+
+    // Reads up to count numbers; returns how many there were
+    int numbers(float* out, int count) {
+        int k = 0;
+        while (k < count && number(out[k])) ++k;
+        return k;
+    }
+
+private:
+    void skipSpace() { while (p < end && isSpace(*p)) ++p; }
+
+    const char* p;
+    const char* end;
+};
+
+// Transforms are 3 or 4 numbers; 16 is a version 1 matrix, converted here
+void parseTransform(line_parser_t& ps, std::string_view prop, text_entry_t& e) {
+    float v[16];
+    int count = ps.numbers(v, 16);
+    if (prop == "TRANSLATION") {
+        if (count == 16) e.translation = translationFromMatrix(v);
+        else if (count >= 3) e.translation = glm::vec3(v[0], v[1], v[2]);
+    } else if (prop == "ROTATION") {
+        if (count == 16) e.rotation = rotationFromMatrix(v);
+        else if (count >= 4) e.rotation = glm::normalize(glm::quat(v[0], v[1], v[2], v[3]));
+    } else {
+        if (count == 16) e.scale = scaleFromMatrix(v);
+        else if (count >= 3) e.scale = glm::vec3(v[0], v[1], v[2]);
+    }
+}
+
+// Parses every SHAPE record in [begin, end). Lines outside a record (the
+// file header) are skipped; any line that is not a known property closes
+// the current record.
+void parseChunk(const char* begin, const char* end, std::vector<text_entry_t>& out) {
+    bool open = false;
+    text_entry_t e;
+    for (const char* line = begin; line < end;) {
+        const char* eol = static_cast<const char*>(std::memchr(line, '\n', end - line));
+        if (!eol) eol = end;
+
+        line_parser_t ps(line, eol);
+        std::string_view prop = ps.keyword();
+        if (prop == "SHAPE") {
+            if (open) out.push_back(e);
+            e = text_entry_t{};
+            ps.number(e.id);
+            open = true;
+        } else if (open) {
+            if (prop == "TYPE") {
+                int t = 0;
+                ps.number(t);
+                e.type = static_cast<ShapeType>(std::clamp(t, 0, static_cast<int>(ICOSPHERE_SHAPE)));
+            }
+            else if (prop == "TRANSLATION" || prop == "ROTATION" || prop == "SCALE") parseTransform(ps, prop, e);
+            else if (prop == "PARENT") ps.number(e.parent_id);
+            else if (prop == "COLOR") ps.numbers(glm::value_ptr(e.color), 4);
+            else {
+                out.push_back(e);
+                open = false;
+            }
+        }
+        line = eol + 1;
+    }
+    if (open) out.push_back(e);
+}
+
+// Moves pos forward to the start of the next "SHAPE " line
+const char* nextRecord(const char* pos, const char* end) {
+    std::string_view rest(pos, end - pos);
+    size_t found = rest.find("\nSHAPE ");
+    return found == std::string_view::npos ? end : pos + found + 1;
+}
+
+} // namespace
+
+bool model_t::loadText(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        std::cout << "Failed to load model from " << filename << std::endl;
+        return false;
+    }
+    // A directory opens fine, but tellg() then fails or reports a huge size.
+    // Failing here leaves the current scene alone.
+    std::streamoff size = file.tellg();
+    if (size < 0 || static_cast<unsigned long long>(size) > MAX_TEXT_MODEL_BYTES) {
+        std::cout << "Failed to load model from " << filename << std::endl;
+        return false;
+    }
+    std::vector<char> buffer(static_cast<size_t>(size));
+    file.seekg(0);
+    file.read(buffer.data(), buffer.size());
+    if (static_cast<size_t>(file.gcount()) != buffer.size()) {
+        std::cout << "Failed to load model from " << filename << std::endl;
+        return false;
+    }
+    file.close();
+
+    const char* begin = buffer.data();
+    const char* end = begin + buffer.size();
+
+    size_t chunks = 1;
+    if (buffer.size() >= PARALLEL_PARSE_MIN_BYTES) {
+        chunks = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // Chunk boundaries are snapped to record starts so no record is split
+    std::vector<const char*> bounds{begin};
+    for (size_t k = 1; k < chunks; ++k) {
+        const char* pos = nextRecord(begin + buffer.size() * k / chunks, end);
+        bounds.push_back(std::max(pos, bounds.back()));
+    }
+    bounds.push_back(end);
+
+    std::vector<std::vector<text_entry_t>> parsed(chunks);
+    if (chunks == 1) {
+        parseChunk(begin, end, parsed[0]);
+    } else {
+        std::vector<std::thread> workers;
+        for (size_t k = 0; k < chunks; ++k) {
+            workers.emplace_back(parseChunk, bounds[k], bounds[k + 1], std::ref(parsed[k]));
+        }
+        for (auto& w : workers) w.join();
+    }
+    buffer = std::vector<char>();
+
+    clear();
+    size_t total = 0;
+    for (const auto& part : parsed) total += part.size();
+    nodes.reserve(total + 1);
+    slots.reserve(total + 1);
+    added.reserve(total + 1);
+    id_index.reserve(total + 1);
+
+    // Shapes share meshes through the mesh cache, so only the first entry of
+    // each (type, level) creates one. Parents are looked up in the id index,
+    // so this is linear in the number of entries.
+    for (const auto& part : parsed) {
+        for (const auto& e : part) {
+            std::unique_ptr<shape_t> s = makeShape(e.type, 2);
+            s->setColor(e.color);
+
+            uint32_t parent = indexOf(findMNodeById(e.parent_id));
+            if (parent == NO_NODE) parent = 0; // unknown parents attach to the root
+            model_node_t* new_node = getNode(createNode(std::move(s), parent, e.id));
+            new_node->color = e.color;
+            new_node->translation = e.translation;
+            new_node->rotation = e.rotation;
+            new_node->scale = e.scale;
+        }
+    }
+    // The root covers every loaded node
+    dirty_roots.assign(1, getRoot());
+    std::cout << "Model loaded from " << filename << std::endl;
+    return true;
+}
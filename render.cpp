@@ -0,0 +1,531 @@
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "bounds.h"
+#include "shape.h"
+#include "globals.h"
+#include "render.h"
+#include "render_queue.h"
+#include "HIERARCHIAL.h"
+
+
+glm::mat4 projection;
+glm::mat4 view;
+int viewportWidth = 800;
+int viewportHeight = 600;
+GLuint shaderProgram = 0;
+GLuint instancedShaderProgram = 0;
+GLuint proceduralShaderProgram = 0;
+bool instancedRendering = false;
+bool proceduralRendering = false;
+bool frustumCulling = true;
+bool autoLod = false;
+bool Wireframe = false;
+bool continuousRendering = false;
+Mode currentMode = MODELLING;
+TransformMode transformMode = NONE;
+char activeAxis = 'X';
+std::shared_ptr<model_t> currentModel;
+node_handle_t currentNode;
+float cameraDistance = 5.0f;
+float cameraAngleX = 0.0f;
+float cameraAngleY = 0.0f;
+glm::mat4 modelRotation = glm::mat4(1.0f);
+render_stats_t renderStats;
+
+
+// Shader Creation
+GLuint buildShaderProgram(const char* vertexShaderSrc, const char* fragmentShaderSrc) {
+    GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(vertexShader, 1, &vertexShaderSrc, nullptr);
+    glCompileShader(vertexShader);
+
+    GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(fragmentShader, 1, &fragmentShaderSrc, nullptr);
+    glCompileShader(fragmentShader);
+
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vertexShader);
+    glAttachShader(program, fragmentShader);
+    glLinkProgram(program);
+
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+
+    return program;
+}
+
+const char* fragmentShaderSrc = R"(
+    #version 330 core
+    in vec4 fragColor;
+    out vec4 color;
+    void main() {
+        color = fragColor;
+    })";
+
+GLuint createShaderProgram() {
+    const char* vertexShaderSrc = R"(
+    #version 330 core
+    layout(location = 0) in vec3 aPos;
+    uniform mat4 MVP;
+    uniform vec4 objectColor;
+    uniform bool useObjectColor;
+    out vec4 fragColor;
+    void main() {
+        gl_Position = MVP * vec4(aPos, 1.0);
+        // Shapes without a color of their own are shaded by position
+        fragColor = useObjectColor ? objectColor : vec4((aPos + 1.0) * 0.5, 1.0);
+    })";
+
+    return buildShaderProgram(vertexShaderSrc, fragmentShaderSrc);
+}
+
+// Same output as createShaderProgram, but the model matrix and color come
+// from per-instance attributes (see mesh_arena_t::attachInstances)
+GLuint createInstancedShaderProgram() {
+    const char* vertexShaderSrc = R"(
+    #version 330 core
+    layout(location = 0) in vec3 aPos;
+    layout(location = 2) in mat4 instanceModel;
+    layout(location = 6) in vec4 instanceColor;
+    layout(location = 7) in float instanceUseColor;
+    uniform mat4 VP;
+    out vec4 fragColor;
+    void main() {
+        gl_Position = VP * instanceModel * vec4(aPos, 1.0);
+        fragColor = instanceUseColor > 0.5 ? instanceColor : vec4((aPos + 1.0) * 0.5, 1.0);
+    })";
+
+    return buildShaderProgram(vertexShaderSrc, fragmentShaderSrc);
+}
+
+
+// Buffer-free primitives: positions are rebuilt from gl_VertexID for the
+// shapeType/level uniforms, triangle by triangle in the order of the index
+// tables in mesh_tables.cpp, so a draw of indexCount vertices with
+// glDrawArrays gives the same mesh. Model matrix and color are per instance,
+// as in createInstancedShaderProgram.
+GLuint createProceduralShaderProgram() {
+    const char* vertexShaderBody = R"(
+    layout(location = 2) in mat4 instanceModel;
+    layout(location = 6) in vec4 instanceColor;
+    layout(location = 7) in float instanceUseColor;
+    uniform mat4 VP;
+    uniform int shapeType; // 0 sphere, 1 cone, 2 box, 3 cylinder, 4 icosphere
+    uniform int level;
+    out vec4 fragColor;
+
+    const float PI = 3.14159265358979;
+    const vec3 boxOrigin[6] = vec3[6](vec3(-1, -1, -1), vec3(-1, -1, 1), vec3(-1, -1, -1),
+                                      vec3(1, -1, -1), vec3(-1, 1, -1), vec3(-1, -1, -1));
+    const vec3 boxU[6] = vec3[6](vec3(2, 0, 0), vec3(2, 0, 0), vec3(0, 0, 2),
+                                 vec3(0, 0, 2), vec3(2, 0, 0), vec3(2, 0, 0));
+    const vec3 boxW[6] = vec3[6](vec3(0, 2, 0), vec3(0, 2, 0), vec3(0, 2, 0),
+                                 vec3(0, 2, 0), vec3(0, 0, 2), vec3(0, 0, 2));
+    const float G = 1.61803398874989;
+    const vec3 icoCorner[12] = vec3[12](vec3(-1, G, 0), vec3(1, G, 0), vec3(-1, -G, 0), vec3(1, -G, 0),
+                                        vec3(0, -1, G), vec3(0, 1, G), vec3(0, -1, -G), vec3(0, 1, -G),
+                                        vec3(G, 0, -1), vec3(G, 0, 1), vec3(-G, 0, -1), vec3(-G, 0, 1));
+    const ivec3 icoFace[20] = ivec3[20](ivec3(0, 11, 5), ivec3(0, 5, 1), ivec3(0, 1, 7), ivec3(0, 7, 10),
+                                        ivec3(0, 10, 11), ivec3(1, 5, 9), ivec3(5, 11, 4), ivec3(11, 10, 2),
+                                        ivec3(10, 7, 6), ivec3(7, 1, 8), ivec3(3, 9, 4), ivec3(3, 4, 2),
+                                        ivec3(3, 2, 6), ivec3(3, 6, 8), ivec3(3, 8, 9), ivec3(4, 9, 5),
+                                        ivec3(2, 4, 11), ivec3(6, 2, 10), ivec3(8, 6, 7), ivec3(9, 8, 1));
+
+    // Point k of a circle split into n, at height y; k == n closes the seam
+    vec3 ring(int k, int n, float y) {
+        float theta = 2.0 * PI * float(k % n) / float(n);
+        return vec3(cos(theta), y, sin(theta));
+    }
+
+    // Grid offset of a corner of the two triangles that make up a quad
+    ivec2 quadCorner(int tri, int corner) {
+        if (tri == 0) return corner == 0 ? ivec2(0, 0) : corner == 1 ? ivec2(1, 0) : ivec2(0, 1);
+        return corner == 0 ? ivec2(1, 0) : corner == 1 ? ivec2(1, 1) : ivec2(0, 1);
+    }
+
+    // Columns of stripWidth quads (sphereStripWidth()), row by row; the pole
+    // rows keep one triangle per quad, the other one has no area
+    vec3 sphereVertex(int t, int corner) {
+        int n = 10 * level; // stacks and slices
+        int stripWidth = n <= VERTEX_CACHE_SIZE ? n : SPHERE_STRIP_WIDTH;
+        int strip = t / (2 * stripWidth * (n - 1));
+        int first = strip * stripWidth;
+        int w = min(stripWidth, n - first);
+        int local = t - strip * 2 * stripWidth * (n - 1);
+        int inner = 2 * w * (n - 2);
+        ivec2 g;
+        if (local < w) g = ivec2(0, first + local) + quadCorner(1, corner);
+        else if (local < w + inner) g = ivec2(1 + (local - w) / (2 * w), first + (local - w) / 2 % w) + quadCorner((local - w) % 2, corner);
+        else g = ivec2(n - 1, first + local - w - inner) + quadCorner(0, corner);
+        float phi = PI * float(g.x) / float(n);
+        return ring(g.y, n, 0.0) * sin(phi) + vec3(0.0, cos(phi), 0.0);
+    }
+
+    // Vertex 0 is the apex, 1 the base center, 2.. the rim; side and base
+    // triangles alternate
+    vec3 coneVertex(int t, int corner) {
+        int slices = 20 * level;
+        int i = t / 2;
+        int v;
+        if (t % 2 == 0) v = corner == 0 ? 0 : i + 1 + corner;
+        else v = corner == 0 ? 1 : i + 4 - corner;
+        if (v == 0) return vec3(0.0, 1.0, 0.0);
+        if (v == 1) return vec3(0.0, -1.0, 0.0);
+        return ring(v - 2, slices, -1.0);
+    }
+
+    vec3 boxVertex(int t, int corner) {
+        int n = level;
+        int face = t / (2 * n * n);
+        int quad = (t % (2 * n * n)) / 2;
+        ivec2 g = ivec2(quad / n, quad % n) + quadCorner(t % 2, corner);
+        vec3 u = boxU[face], w = boxW[face];
+        return boxOrigin[face] + u * (float(g.x) / float(n)) * 2.0 + w * (float(g.y) / float(n)) * 2.0 - (u + w);
+    }
+
+    vec3 cylinderVertex(int t, int corner) {
+        int slices = 20 * level;
+        int step = t % 2 == 0 ? (corner == 2 ? 1 : 0) : (corner == 0 ? 0 : 1);
+        bool bottom = t % 2 == 0 ? corner == 1 : corner != 2;
+        return ring(t / 2 + step, slices, bottom ? -1.0 : 1.0);
+    }
+
+    // Same triangles as icosphere_t, face by face: strip r of a face lies
+    // between grid rows r and r + 1 and holds 2r + 1 triangles
+    vec3 icosphereVertex(int t, int corner) {
+        int f = 2 * level;
+        ivec3 face = icoFace[t / (f * f)];
+        int local = t % (f * f);
+        int r = int(sqrt(float(local)));
+        if ((r + 1) * (r + 1) <= local) ++r;
+        if (r * r > local) --r;
+        int k = local - r * r;
+        int m = k / 2;
+        ivec2 g = k % 2 == 0 ? ivec2(r - m, m) + quadCorner(0, corner)
+                             : ivec2(r - 1 - m, m) + quadCorner(1, corner);
+        vec3 p = icoCorner[face.x] * float(f - g.x - g.y) + icoCorner[face.y] * float(g.x) + icoCorner[face.z] * float(g.y);
+        return normalize(p);
+    }
+
+    void main() {
+        int t = gl_VertexID / 3;
+        int corner = gl_VertexID % 3;
+        vec3 pos = shapeType == 0 ? sphereVertex(t, corner)
+                 : shapeType == 1 ? coneVertex(t, corner)
+                 : shapeType == 2 ? boxVertex(t, corner)
+                 : shapeType == 3 ? cylinderVertex(t, corner)
+                 : icosphereVertex(t, corner);
+        gl_Position = VP * instanceModel * vec4(pos, 1.0);
+        fragColor = instanceUseColor > 0.5 ? instanceColor : vec4((pos + 1.0) * 0.5, 1.0);
+    })";
+
+    // #version has to come first, so the table constants go in after it
+    std::string vertexShaderSrc = "#version 330 core\n"
+        "#define VERTEX_CACHE_SIZE " + std::to_string(VERTEX_CACHE_SIZE) + "\n"
+        "#define SPHERE_STRIP_WIDTH " + std::to_string(SPHERE_STRIP_WIDTH) + "\n" + vertexShaderBody;
+    return buildShaderProgram(vertexShaderSrc.c_str(), fragmentShaderSrc);
+}
+
+// Rendering Logic
+// The frame's flat draw list: nodes that survive culling, in pool
+// (depth-first) order, from model_t::collectVisible()
+std::vector<const model_node_t*> visibleNodes;
+
+// Automatic LOD: the level follows the projected radius of a node's bounds,
+// one level per doubling, so below LOD_BASE_PIXELS is level 1 and 32x that
+// is level 6
+const float LOD_BASE_PIXELS = 8.0f;
+bool lodActive = false;
+
+void selectLods(const std::vector<const model_node_t*>& nodes) {
+    glm::vec3 eye = glm::vec3(glm::inverse(view)[3]);
+    float pixelsPerUnit = projection[1][1] * 0.5f * viewportHeight; // at distance 1
+    for (const model_node_t* node : nodes) {
+        const aabb_t& b = node->worldBounds;
+        if (b.isEmpty()) continue;
+        float radius = 0.5f * glm::length(b.max - b.min);
+        float distance = std::max(glm::length(0.5f * (b.min + b.max) - eye), 1e-3f);
+        float pixels = std::max(radius * pixelsPerUnit / distance, 1e-3f);
+        node->shape->selectLod(1.0f + std::log2(pixels / LOD_BASE_PIXELS), !proceduralRendering);
+    }
+}
+
+void updateLods(const std::vector<model_node_t>& nodes) {
+    if (autoLod) {
+        if (!lodActive) mesh_cache_t::instance().precomputeLods();
+        lodActive = true;
+        selectLods(visibleNodes);
+    } else if (lodActive) {
+        // Back to the hand-set levels
+        for (const model_node_t& node : nodes) {
+            if (node.shape) node.shape->resetLod();
+        }
+        lodActive = false;
+    }
+}
+
+// World and MVP matrices come from model_t::updateTransforms(); each node
+// becomes one record and the queue issues them in state order
+void renderNodes(const std::vector<const model_node_t*>& nodes) {
+    render_queue_t& queue = render_queue_t::instance();
+    GLenum polygonMode = Wireframe ? GL_LINE : GL_FILL;
+    for (const model_node_t* node : nodes) {
+        const shape_t& shape = *node->shape;
+        if (!shape.mesh || !shape.mesh->isUploaded()) continue; // still being built
+        queue.submit(shaderProgram, polygonMode, node->mvpMatrix, shape.hasColor ? &shape.color : nullptr,
+                     shape.mesh->gpu);
+        renderStats.triangles += shape.getTriangleCount();
+    }
+    queue.flush();
+}
+
+// Batched path: every visible node becomes one instance record, grouped by
+// the mesh it uses (the same thing as grouping by type and tesselation
+// level). Each group is one indirect draw command whose baseInstance points
+// at its records, so the frame goes out as a single glMultiDrawElementsIndirect
+// per index width no matter how many nodes there are.
+std::unordered_map<mesh_t*, std::vector<instance_t>> instanceBatches;
+std::vector<instance_t> frameInstances;
+std::vector<draw_command_t> frameCommands, wideCommands;
+
+// Meshes that are not on the GPU are left out unless the draw does not
+// read them (the procedural path)
+void collectInstances(const std::vector<const model_node_t*>& nodes, bool needsUpload) {
+    for (const model_node_t* node : nodes) {
+        if (!node->shape->mesh || (needsUpload && !node->shape->mesh->isUploaded())) continue;
+        instanceBatches[node->shape->mesh.get()].push_back(
+            {node->worldMatrix, node->shape->color, node->shape->hasColor ? 1.0f : 0.0f});
+        renderStats.triangles += node->shape->getTriangleCount();
+    }
+}
+
+// Flattens the batches into frameInstances and frameCommands (16-bit index
+// commands first); returns how many commands use 16-bit indices
+size_t buildDrawCommands() {
+    frameInstances.clear();
+    frameCommands.clear();
+    wideCommands.clear();
+
+    // Every mesh in the map is held alive by a node collected this frame;
+    // entries left empty belong to meshes that may have been freed since
+    for (auto it = instanceBatches.begin(); it != instanceBatches.end();) {
+        std::vector<instance_t>& instances = it->second;
+        if (instances.empty()) {
+            it = instanceBatches.erase(it);
+            continue;
+        }
+
+        mesh_t* mesh = it->first;
+        if (mesh->gpu.valid) {
+            draw_command_t command{mesh->gpu.indexCount, static_cast<GLuint>(instances.size()),
+                                   mesh->gpu.firstIndex, static_cast<GLint>(mesh->gpu.baseVertex),
+                                   static_cast<GLuint>(frameInstances.size())};
+            (mesh->gpu.wideIndices ? wideCommands : frameCommands).push_back(command);
+            frameInstances.insert(frameInstances.end(), instances.begin(), instances.end());
+        }
+
+        instances.clear(); // keep the capacity for the next frame
+        ++it;
+    }
+
+    size_t shortCount = frameCommands.size();
+    frameCommands.insert(frameCommands.end(), wideCommands.begin(), wideCommands.end());
+    return shortCount;
+}
+
+void renderInstanced(const std::vector<const model_node_t*>& nodes) {
+    collectInstances(nodes, true);
+    size_t shortCount = buildDrawCommands();
+    if (frameCommands.empty()) return;
+
+    render_queue_t& queue = render_queue_t::instance();
+    queue.useProgram(instancedShaderProgram);
+    glm::mat4 VP = projection * view;
+    glUniformMatrix4fv(queue.uniforms(instancedShaderProgram).vp, 1, GL_FALSE, glm::value_ptr(VP));
+    ++renderStats.uniformUploads;
+
+    mesh_arena_t& arena = mesh_arena_t::instance();
+    arena.uploadInstances(frameInstances.data(), frameInstances.size());
+
+    if (arena.hasMultiDrawIndirect()) {
+        arena.uploadCommands(frameCommands.data(), frameCommands.size());
+        if (shortCount > 0) {
+            arena.bind(false);
+            glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_SHORT, nullptr,
+                                        static_cast<GLsizei>(shortCount), 0);
+            ++renderStats.drawCalls;
+        }
+        if (frameCommands.size() > shortCount) {
+            arena.bind(true);
+            glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+                                        (void*)(shortCount * sizeof(draw_command_t)),
+                                        static_cast<GLsizei>(frameCommands.size() - shortCount), 0);
+            ++renderStats.drawCalls;
+        }
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    } else {
+        // GL 3.3 draws cannot start at an instance offset, so the instance
+        // attributes are re-pointed for each mesh instead
+        for (size_t k = 0; k < frameCommands.size(); ++k) {
+            const draw_command_t& command = frameCommands[k];
+            bool wide = k >= shortCount;
+            arena.setInstanceBase(command.baseInstance);
+            arena.bind(wide);
+            size_t indexSize = wide ? sizeof(uint32_t) : sizeof(uint16_t);
+            glDrawElementsInstancedBaseVertex(GL_TRIANGLES, static_cast<GLsizei>(command.count),
+                                              wide ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT,
+                                              (void*)(command.firstIndex * indexSize),
+                                              static_cast<GLsizei>(command.instanceCount), command.baseVertex);
+            ++renderStats.drawCalls;
+        }
+    }
+}
+
+// Procedural path: the batches of collectInstances() become one
+// glDrawArraysInstanced per (type, level), with no vertex or index buffer
+// bound. The shader knows every ShapeType; only the vertex count comes from
+// the mesh (its table, or the generated mesh once built).
+struct procedural_draw_t {
+    ShapeType type;
+    unsigned int level;
+    GLsizei vertexCount;
+    size_t firstInstance;
+    GLsizei instanceCount;
+};
+std::vector<procedural_draw_t> proceduralDraws;
+
+void renderProcedural(const std::vector<const model_node_t*>& nodes) {
+    collectInstances(nodes, false);
+    frameInstances.clear();
+    proceduralDraws.clear();
+    for (auto it = instanceBatches.begin(); it != instanceBatches.end();) {
+        std::vector<instance_t>& instances = it->second;
+        if (instances.empty()) {
+            it = instanceBatches.erase(it);
+            continue;
+        }
+        const mesh_t* mesh = it->first;
+        const unit_mesh_view_t* unit = findUnitMesh(mesh->type, mesh->level);
+        size_t count = unit ? unit->indexCount : mesh->isBuilt() ? mesh->indexCount() : 0;
+        if (count > 0) {
+            proceduralDraws.push_back({mesh->type, mesh->level, static_cast<GLsizei>(count),
+                                       frameInstances.size(), static_cast<GLsizei>(instances.size())});
+            frameInstances.insert(frameInstances.end(), instances.begin(), instances.end());
+        }
+        instances.clear();
+        ++it;
+    }
+    if (proceduralDraws.empty()) return;
+
+    render_queue_t& queue = render_queue_t::instance();
+    queue.useProgram(proceduralShaderProgram);
+    const program_uniforms_t& u = queue.uniforms(proceduralShaderProgram);
+    glm::mat4 VP = projection * view;
+    glUniformMatrix4fv(u.vp, 1, GL_FALSE, glm::value_ptr(VP));
+    ++renderStats.uniformUploads;
+
+    mesh_arena_t& arena = mesh_arena_t::instance();
+    arena.uploadInstances(frameInstances.data(), frameInstances.size());
+    for (const procedural_draw_t& draw : proceduralDraws) {
+        glUniform1i(u.shapeType, draw.type);
+        glUniform1i(u.level, static_cast<GLint>(draw.level));
+        renderStats.uniformUploads += 2;
+        arena.setInstanceBase(draw.firstInstance); // also binds the arena's VAO
+        glDrawArraysInstanced(GL_TRIANGLES, 0, draw.vertexCount, draw.instanceCount);
+        ++renderStats.drawCalls;
+    }
+}
+
+void renderModel(const glm::mat4& rootTransform) {
+    if (!currentModel) return;
+    glm::mat4 VP = projection * view;
+    currentModel->updateTransforms(rootTransform, VP);
+    currentModel->collectVisible(VP, frustumCulling, visibleNodes);
+    updateLods(currentModel->getNodes());
+    renderStats.nodesDrawn = static_cast<unsigned int>(visibleNodes.size());
+    renderStats.nodesCulled = static_cast<unsigned int>(currentModel->getShapeCount() - visibleNodes.size());
+
+    if (proceduralRendering) {
+        renderProcedural(visibleNodes);
+    } else if (instancedRendering) {
+        renderInstanced(visibleNodes);
+    } else {
+        renderNodes(visibleNodes);
+    }
+}
+
+void renderScene() {
+    projection = glm::perspective(glm::radians(45.0f), float(viewportWidth) / float(viewportHeight), 0.1f, 100.0f);
+    
+    if (currentMode == INSPECTION) {
+        view = glm::lookAt(
+            glm::vec3(cameraDistance * sin(glm::radians(cameraAngleY)) * cos(glm::radians(cameraAngleX)),
+                      cameraDistance * sin(glm::radians(cameraAngleX)),
+                      cameraDistance * cos(glm::radians(cameraAngleY)) * cos(glm::radians(cameraAngleX))),
+            glm::vec3(0.0f, 0.0f, 0.0f),
+            glm::vec3(0.0f, 1.0f, 0.0f)
+        );
+        renderModel(modelRotation);
+    } else {
+        view = glm::lookAt(glm::vec3(0.0f, 0.0f, 10.0f),
+                          glm::vec3(0.0f, 0.0f, 0.0f),
+                          glm::vec3(0.0f, 1.0f, 0.0f));
+        renderModel(glm::mat4(1.0f));
+    }
+}
+
+bool initRenderer() {
+    glEnable(GL_DEPTH_TEST);
+    render_queue_t::instance().invalidate();
+
+    shaderProgram = createShaderProgram();
+    if (shaderProgram == 0) return false;
+    instancedShaderProgram = createInstancedShaderProgram();
+    if (instancedShaderProgram == 0) return false;
+    proceduralShaderProgram = createProceduralShaderProgram();
+    return proceduralShaderProgram != 0;
+}
+
+// What the last renderFrame() drew, for redrawNeeded()
+bool redrawRequested = true;
+const model_t* drawnModel = nullptr;
+uint64_t drawnRevision = 0;
+uint64_t drawnShapeEdits = 0;
+
+void requestRedraw() {
+    redrawRequested = true;
+}
+
+bool redrawNeeded() {
+    if (continuousRendering || redrawRequested) return true;
+    if (currentModel.get() != drawnModel) return true;
+    if (currentModel && currentModel->getRevision() != drawnRevision) return true;
+    if (shape_t::edits.load(std::memory_order_relaxed) != drawnShapeEdits) return true;
+    // The procedural path does not draw meshes, see renderFrame()
+    return !proceduralRendering && mesh_builder_t::instance().uploadsWaiting();
+}
+
+void renderFrame() {
+    renderStats = render_stats_t{};
+    redrawRequested = false;
+    drawnModel = currentModel.get();
+    drawnRevision = currentModel ? currentModel->getRevision() : 0;
+    drawnShapeEdits = shape_t::edits.load(std::memory_order_relaxed);
+    // Meshes the builder finished since the last frame become drawable. The
+    // procedural path does not read them, so they wait until it is left.
+    if (!proceduralRendering) mesh_builder_t::instance().uploadFinished(MESH_UPLOAD_BUDGET_MS);
+    glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    render_queue_t::instance().setPolygonMode(Wireframe ? GL_LINE : GL_FILL);
+    renderScene();
+}
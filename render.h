@@ -0,0 +1,36 @@
+#ifndef RENDER_H
+#define RENDER_H
+
+#include <GL/glew.h>
+
+// Counters for the last frame, reset by renderFrame()
+struct render_stats_t {
+    unsigned int drawCalls = 0;
+    unsigned int stateChanges = 0;   // program, VAO/index buffer and polygon mode switches
+    unsigned int uniformUploads = 0;
+    unsigned int nodesDrawn = 0;
+    unsigned int nodesCulled = 0;
+    unsigned long long triangles = 0;
+};
+extern render_stats_t renderStats;
+
+// Compiles the shaders and sets the GL state renderScene() expects; needs a
+// current context with GLEW initialised
+bool initRenderer();
+GLuint createShaderProgram();
+GLuint createInstancedShaderProgram();
+GLuint createProceduralShaderProgram();
+void renderScene();
+// Clears the bound framebuffer and draws currentModel with renderScene()
+void renderFrame();
+
+// Render on demand: the main loop only draws when redrawNeeded() and
+// otherwise sleeps in glfwWaitEvents(). Model edits and shape_t::setColor()/
+// setLevel() are picked up by themselves; view and display settings call
+// requestRedraw().
+void requestRedraw();
+// A frame is due: requested, the model or a shape changed since the last
+// renderFrame(), finished meshes wait for upload, or continuousRendering
+bool redrawNeeded();
+
+#endif
@@ -0,0 +1,136 @@
+#include "render_queue.h"
+#include "render.h"
+#include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+
+namespace {
+
+// Key fields, most significant first; the low 32 bits keep submission order
+// so draws with the same state stay in traversal order
+constexpr int PROGRAM_SHIFT = 56;
+constexpr int VAO_SHIFT = 48;
+constexpr int MODE_SHIFT = 46;
+constexpr uint64_t WIDE_INDEX_BIT = 1ull << 45;
+constexpr uint64_t SLOT_MASK = 0xFF;
+constexpr uint64_t BIND_MASK = (SLOT_MASK << VAO_SHIFT) | WIDE_INDEX_BIT;
+
+constexpr GLenum POLYGON_MODES[] = {GL_FILL, GL_LINE, GL_POINT};
+
+uint64_t modeIndex(GLenum mode) {
+    return mode == GL_LINE ? 1 : mode == GL_POINT ? 2 : 0;
+}
+
+bool byKey(const draw_record_t& a, const draw_record_t& b) {
+    return a.key < b.key;
+}
+
+} // namespace
+
+render_queue_t& render_queue_t::instance() {
+    static render_queue_t queue;
+    return queue;
+}
+
+uint64_t render_queue_t::slotOf(std::vector<GLuint>& names, GLuint name) {
+    auto it = std::find(names.begin(), names.end(), name);
+    if (it != names.end()) return static_cast<uint64_t>(it - names.begin());
+    names.push_back(name);
+    return names.size() - 1;
+}
+
+// Every mesh lives in the mesh arena, so the VAO is always the arena's and
+// the bind only changes with the index width
+void render_queue_t::submit(GLuint program, GLenum polygonMode, const glm::mat4& mvp, const glm::vec4* color,
+                            const mesh_allocation_t& mesh) {
+    uint64_t key = slotOf(programSlots, program) << PROGRAM_SHIFT |
+                   slotOf(vaoSlots, mesh_arena_t::instance().vertexArray()) << VAO_SHIFT |
+                   modeIndex(polygonMode) << MODE_SHIFT |
+                   static_cast<uint64_t>(records.size());
+    if (mesh.wideIndices) key |= WIDE_INDEX_BIT;
+    records.push_back({key, &mvp, color, &mesh});
+}
+
+void render_queue_t::flush() {
+    if (records.empty()) return;
+    // Usually the whole frame shares one state and the keys already ascend
+    if (!std::is_sorted(records.begin(), records.end(), byKey)) std::sort(records.begin(), records.end(), byKey);
+
+    mesh_arena_t& arena = mesh_arena_t::instance();
+    // Other paths bind the arena between flushes, so the first draw always binds
+    uint64_t bound = ~0ull;
+    const program_uniforms_t* u = nullptr;
+    GLuint uniformsOf = 0;
+    int useColor = -1;
+    const glm::vec4* lastColor = nullptr;
+
+    for (const draw_record_t& r : records) {
+        GLuint program = programSlots[(r.key >> PROGRAM_SHIFT) & SLOT_MASK];
+        useProgram(program);
+        if (program != uniformsOf) {
+            u = &uniforms(program);
+            uniformsOf = program;
+            useColor = -1;
+            lastColor = nullptr;
+        }
+        setPolygonMode(POLYGON_MODES[(r.key >> MODE_SHIFT) & 3]);
+        if ((r.key & BIND_MASK) != bound) {
+            arena.bind(r.mesh->wideIndices);
+            bound = r.key & BIND_MASK;
+            ++renderStats.stateChanges;
+        }
+
+        glUniformMatrix4fv(u->mvp, 1, GL_FALSE, glm::value_ptr(*r.mvp));
+        ++renderStats.uniformUploads;
+        int wanted = r.color ? 1 : 0;
+        if (wanted != useColor) {
+            glUniform1i(u->useObjectColor, wanted);
+            useColor = wanted;
+            ++renderStats.uniformUploads;
+        }
+        if (r.color && (!lastColor || *r.color != *lastColor)) {
+            glUniform4fv(u->objectColor, 1, glm::value_ptr(*r.color));
+            lastColor = r.color;
+            ++renderStats.uniformUploads;
+        }
+
+        arena.drawElements(*r.mesh);
+        ++renderStats.drawCalls;
+    }
+    records.clear();
+}
+
+const program_uniforms_t& render_queue_t::uniforms(GLuint program) {
+    auto it = programUniforms.find(program);
+    if (it != programUniforms.end()) return it->second;
+
+    program_uniforms_t u;
+    u.mvp = glGetUniformLocation(program, "MVP");
+    u.objectColor = glGetUniformLocation(program, "objectColor");
+    u.useObjectColor = glGetUniformLocation(program, "useObjectColor");
+    u.vp = glGetUniformLocation(program, "VP");
+    u.shapeType = glGetUniformLocation(program, "shapeType");
+    u.level = glGetUniformLocation(program, "level");
+    return programUniforms.emplace(program, u).first->second;
+}
+
+void render_queue_t::useProgram(GLuint program) {
+    if (program == currentProgram) return;
+    glUseProgram(program);
+    currentProgram = program;
+    ++renderStats.stateChanges;
+}
+
+void render_queue_t::setPolygonMode(GLenum mode) {
+    if (mode == currentPolygonMode) return;
+    glPolygonMode(GL_FRONT_AND_BACK, mode);
+    currentPolygonMode = mode;
+    ++renderStats.stateChanges;
+}
+
+void render_queue_t::invalidate() {
+    currentProgram = 0;
+    currentPolygonMode = 0;
+    programUniforms.clear();
+    programSlots.clear();
+    vaoSlots.clear();
+}
@@ -0,0 +1,66 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "mesh_arena.h"
+
+// One per-node draw. The pointers must stay valid until flush().
+struct draw_record_t {
+    uint64_t key;                   // state first, then submission order
+    const glm::mat4* mvp;
+    const glm::vec4* color;         // nullptr: shaded by position
+    const mesh_allocation_t* mesh;
+};
+
+// Uniforms of the renderer's programs; -1 where a program lacks one
+struct program_uniforms_t {
+    GLint mvp = -1;
+    GLint objectColor = -1;
+    GLint useObjectColor = -1;
+    GLint vp = -1;
+    GLint shapeType = -1;
+    GLint level = -1;
+};
+
+// Sits between the scene graph and GL. Traversal submits one compact record
+// per node; flush() sorts them by program, VAO, polygon mode and index width
+// and issues them, touching only the state that differs from the previous
+// draw. Every render path changes program and polygon mode through here, so
+// state is never set twice across paths, and uniform locations are looked
+// up once per program.
+class render_queue_t {
+public:
+    static render_queue_t& instance();
+
+    render_queue_t(const render_queue_t&) = delete;
+    render_queue_t& operator=(const render_queue_t&) = delete;
+
+    void submit(GLuint program, GLenum polygonMode, const glm::mat4& mvp, const glm::vec4* color,
+                const mesh_allocation_t& mesh);
+    // Draws and clears everything submitted; counts into renderStats
+    void flush();
+
+    const program_uniforms_t& uniforms(GLuint program);
+    void useProgram(GLuint program);
+    void setPolygonMode(GLenum mode);
+    // Forgets tracked state and cached locations, for a new context or new
+    // programs; nothing may be queued
+    void invalidate();
+
+private:
+    render_queue_t() = default;
+    uint64_t slotOf(std::vector<GLuint>& names, GLuint name);
+
+    std::vector<draw_record_t> records;
+    std::vector<GLuint> programSlots, vaoSlots; // key fields are indices into these
+    std::unordered_map<GLuint, program_uniforms_t> programUniforms;
+
+    GLuint currentProgram = 0;
+    GLenum currentPolygonMode = 0; // 0 until first set
+};
+
+#endif
@@ -3,127 +3,183 @@
 #include <iostream>
 #include <vector>
 #include <memory>
+#include <map>
+#include <unordered_map>
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cmath>
 #include <GL/glew.h>   
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include "bounds.h"
+#include "mesh_arena.h"
+#include "mesh_builder.h"
+#include "mesh_tables.h"
+#include "mesh_optimizer.h"
 
 // Shape Types
 enum ShapeType {
     SPHERE_SHAPE,
     CONE_SHAPE,
     BOX_SHAPE,
-    CYLINDER_SHAPE
+    CYLINDER_SHAPE,
+    ICOSPHERE_SHAPE  // sphere made from a subdivided icosahedron
+};
+constexpr int SHAPE_TYPE_COUNT = ICOSPHERE_SHAPE + 1;
+
+// Lower-case names, as used on the benchmark command lines
+inline const char* shapeTypeName(int type) {
+    static const char* names[SHAPE_TYPE_COUNT] = {"sphere", "cone", "box", "cylinder", "icosphere"};
+    return type >= 0 && type < SHAPE_TYPE_COUNT ? names[type] : "unknown";
+}
+
+// Geometry shared by every shape with the same (type, tesselation level).
+// Owned through mesh_cache_t, so identical primitives hold one CPU copy and
+// one set of GPU buffers no matter how many nodes use them.
+// Vertices are bare positions; color is per node (a uniform or an instance
+// attribute), so recoloring never touches the mesh.
+// Built-in primitives read their geometry from the compile-time tables in
+// mesh_tables.h; anything else is generated into the vectors by build() on
+// a mesh_builder_t worker and passed through optimizeMesh(). Until isBuilt()
+// only type, level and bounds may be read, and the mesh is not drawn until
+// the render thread has uploaded it.
+struct mesh_t {
+    ShapeType type;
+    unsigned int level;
+    std::vector<glm::vec3> vertices;
+    // Indices as generated. compactIndices() moves them into shortIndices
+    // when every vertex is reachable with 16 bits.
+    std::vector<unsigned int> indices;
+    std::vector<uint16_t> shortIndices;
+    const unit_mesh_view_t* table = nullptr; // set instead of the vectors
+    aabb_t bounds; // object-space bounds, known before the geometry is
+    mesh_optimize_stats_t optimizeStats; // what optimizeMesh() did to generated geometry
+
+    mesh_allocation_t gpu; // where upload() put the mesh in the mesh arena
+    std::atomic<bool> built{false};
+
+    // Table meshes bring exact bounds; generated ones fill the cube [-1, 1]^3
+    mesh_t(ShapeType t, unsigned int l) : type(t), level(l) {
+        if (const unit_mesh_view_t* unit = findUnitMesh(type, level)) {
+            bounds.expand(glm::vec3(unit->lower.x, unit->lower.y, unit->lower.z));
+            bounds.expand(glm::vec3(unit->upper.x, unit->upper.y, unit->upper.z));
+        } else {
+            bounds.expand(glm::vec3(-1.0f));
+            bounds.expand(glm::vec3(1.0f));
+        }
+    }
+    mesh_t(const mesh_t&) = delete;
+    mesh_t& operator=(const mesh_t&) = delete;
+
+    ~mesh_t() {
+        if (gpu.valid) mesh_arena_t::instance().release(gpu);
+    }
+
+    // Fills in the geometry; may run on a builder thread
+    void build();
+    bool isBuilt() const { return built.load(std::memory_order_acquire); }
+    bool isUploaded() const { return gpu.valid; }
+
+    void compactIndices() {
+        if (vertices.size() > 0x10000 || indices.empty()) return;
+        shortIndices.assign(indices.begin(), indices.end());
+        indices.clear();
+        indices.shrink_to_fit();
+    }
+
+    size_t vertexCount() const { return table ? table->vertexCount : vertices.size(); }
+    const glm::vec3* vertexData() const {
+        static_assert(sizeof(table_vertex_t) == sizeof(glm::vec3), "table vertices must match glm::vec3");
+        return table ? reinterpret_cast<const glm::vec3*>(table->vertices) : vertices.data();
+    }
+    size_t indexCount() const {
+        if (table) return table->indexCount;
+        return shortIndices.empty() ? indices.size() : shortIndices.size();
+    }
+    GLenum indexType() const { return table || !shortIndices.empty() ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT; }
+    size_t indexBytes() const {
+        return indexCount() * (indexType() == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(unsigned int));
+    }
+    const void* indexData() const {
+        if (table) return table->indices;
+        return shortIndices.empty() ? static_cast<const void*>(indices.data()) : shortIndices.data();
+    }
+
+    // Post-transform cache misses per triangle of the order as drawn
+    float cacheMissRatio() const {
+        if (indexType() == GL_UNSIGNED_SHORT) {
+            return analyzeVertexCache(static_cast<const uint16_t*>(indexData()), indexCount(), vertexCount());
+        }
+        return analyzeVertexCache(static_cast<const unsigned int*>(indexData()), indexCount(), vertexCount());
+    }
+
+    // Copies the mesh into the shared GPU buffers; render thread only, see
+    // mesh_builder_t::uploadFinished()
+    void upload() {
+        if (gpu.valid || !isBuilt()) return;
+        mesh_arena_t::instance().allocate(vertexData(), vertexCount(), indexData(), indexCount(),
+                                          indexType() == GL_UNSIGNED_INT, gpu);
+    }
 };
 
 // Base Class
+// A shape is a light per-node handle: the shared mesh it uses plus its own
+// color. The geometry itself lives in the mesh cache.
 class shape_t {
 public:
-    std::vector<glm::vec4> vertices;
-    std::vector<glm::vec4> colors;
-    std::vector<unsigned int> indices;
+    std::shared_ptr<mesh_t> mesh;
+    glm::vec4 color{1.0f};
+    bool hasColor = false; // false: shaded by object-space position
 
-    GLuint VAO = 0, VBO = 0, CBO = 0, EBO = 0;
     ShapeType shapetype;
     unsigned int level;
-    shape_t() : level(1) {}  
-   shape_t(unsigned int tesselation_level) : level(tesselation_level) {
+    unsigned int lodLevel = 0; // level picked by selectLod(), 0 when not in use
+
+    // Bumped by setColor() and setLevel() on any shape; with
+    // model_t::getRevision() it tells the render loop a frame is due
+    static inline std::atomic<uint64_t> edits{0};
+    shape_t(ShapeType t, unsigned int tesselation_level) : shapetype(t), level(tesselation_level) {
         if (level < 1) level = 1;
-        if (level > 4) level = 4;
+        if (level > 6) level = 6;
+        acquireMesh();
     }
 
-    virtual ~shape_t() {
-        if (VAO) glDeleteVertexArrays(1, &VAO);
-        if (VBO) glDeleteBuffers(1, &VBO);
-        if (CBO) glDeleteBuffers(1, &CBO);
-        if (EBO) glDeleteBuffers(1, &EBO);
-    }
+    virtual ~shape_t() {}
 
     ShapeType getType() const { return shapetype; }
 
-    virtual void generateGeometry() = 0;
+    // Points this shape at the cached mesh for its current (type, level)
+    void acquireMesh();
     unsigned int getLevel() const { return level; }
+    size_t getTriangleCount() const { return mesh && mesh->isBuilt() ? mesh->indexCount() / 3 : 0; }
     void setLevel(unsigned int l) {
         if (l < 1) l = 1;
-        if (l > 4) l = 4;
-        if (level != l) {
+        if (l > 6) l = 6;
+        if (level != l || lodLevel != 0) {
             level = l;
-            generateGeometry();
-            VAO = VBO = CBO = EBO = 0; // force GPU buffer update
+            lodLevel = 0;
+            acquireMesh(); // the old mesh is freed once no other shape uses it
+            edits.fetch_add(1, std::memory_order_relaxed);
         }}
-    virtual void setColor(const glm::vec4& c) {
-        if (vertices.empty()) {
-            colors.assign(1, c);
-        } else {
-            colors.assign(vertices.size(), c);
-        }
 
-        // Update GPU buffer if already created
-        if (CBO != 0) {
-            glBindBuffer(GL_ARRAY_BUFFER, CBO);
-            glBufferSubData(GL_ARRAY_BUFFER, 0, colors.size() * sizeof(glm::vec4), colors.data());
-            glBindBuffer(GL_ARRAY_BUFFER, 0);
-        }
-    }
-
-    void setupBuffers() {
-        if (VAO != 0) return;  
-
-        glGenVertexArrays(1, &VAO);
-        glBindVertexArray(VAO);
-
-        // Vertex positions
-        glGenBuffers(1, &VBO);
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glBufferData(GL_ARRAY_BUFFER,
-                     vertices.size() * sizeof(glm::vec4),
-                     vertices.data(),
-                     GL_STATIC_DRAW);
-        glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, (void*)0);
-        glEnableVertexAttribArray(0);
-
-        // Ensure colors exist
-        if (colors.empty()) {
-            colors.assign(vertices.size(), glm::vec4(1.0f)); 
-        }
-
-        // Vertex colors
-        glGenBuffers(1, &CBO);
-        glBindBuffer(GL_ARRAY_BUFFER, CBO);
-        glBufferData(GL_ARRAY_BUFFER,
-                     colors.size() * sizeof(glm::vec4),
-                     colors.data(),
-                     GL_STATIC_DRAW);
-        glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 0, (void*)0);
-        glEnableVertexAttribArray(1);
-
-        // Indices
-        glGenBuffers(1, &EBO);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-                     indices.size() * sizeof(unsigned int),
-                     indices.data(),
-                     GL_STATIC_DRAW);
-
-        glBindVertexArray(0);
+    // Automatic level of detail. lodValue is the continuous level the node's
+    // screen size asks for (see render.cpp); the drawn level only changes
+    // once lodValue leaves the current level's band by LOD_HYSTERESIS, so
+    // nodes sitting on a threshold do not flicker between two meshes.
+    static constexpr float LOD_HYSTERESIS = 0.25f;
+    // Unless uploadedOnly is false, a new level is only taken once its mesh
+    // is on the GPU
+    void selectLod(float lodValue, bool uploadedOnly = true);
+    // Goes back to the hand-set level
+    void resetLod();
+    virtual void setColor(const glm::vec4& c) {
+        color = c;
+        hasColor = true;
+        edits.fetch_add(1, std::memory_order_relaxed);
     }
 
-    virtual void draw(const glm::mat4& MVP, GLuint shaderProgram) {
-        if (VAO == 0) {
-            generateGeometry();
-            setupBuffers();
-        }
-
-        // Upload MVP
-        GLint mvpLoc = glGetUniformLocation(shaderProgram, "MVP");
-        if (mvpLoc != -1) {
-            glUniformMatrix4fv(mvpLoc, 1, GL_FALSE, glm::value_ptr(MVP));
-        }
-
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(indices.size()), GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
-    }
-    
     void changeTesselation(int delta) {
         int newLevel = static_cast<int>(level) + delta;
         if (newLevel < 1) newLevel = 1;
@@ -134,211 +190,212 @@ public:
 // Sphere
 class sphere_t : public shape_t {
 public:
-    sphere_t(unsigned int tesselation_level = 1) : shape_t(tesselation_level) {
-        shapetype = SPHERE_SHAPE;
-    }
-
-    void generateGeometry() override {
-        vertices.clear();
-        colors.clear();
-        indices.clear();
-
-        unsigned int stacks = 10 * level;
-        unsigned int slices = 10 * level;
-
-        for (unsigned int i = 0; i <= stacks; ++i) {
-            float phi = glm::pi<float>() * i / stacks;
-            for (unsigned int j = 0; j <= slices; ++j) {
-                float theta = 2.0f * glm::pi<float>() * j / slices;
-                float x = sin(phi) * cos(theta);
-                float y = cos(phi);
-                float z = sin(phi) * sin(theta);
-
-                vertices.emplace_back(x, y, z, 1.0f);
-                colors.emplace_back((x+1)/2, (y+1)/2, (z+1)/2, 1.0f);
-            }
-        }
-
-        for (unsigned int i = 0; i < stacks; ++i) {
-            for (unsigned int j = 0; j < slices; ++j) {
-                unsigned int first = i * (slices + 1) + j;
-                unsigned int second = first + slices + 1;
-
-                indices.push_back(first);
-                indices.push_back(second);
-                indices.push_back(first + 1);
-
-                indices.push_back(second);
-                indices.push_back(second + 1);
-                indices.push_back(first + 1);
-            }
-        }
-    }
+    sphere_t(unsigned int tesselation_level = 1) : shape_t(SPHERE_SHAPE, tesselation_level) {}
 };
 
 // Cone
 class cone_t : public shape_t {
 public:
-    cone_t(unsigned int tesselation_level = 2) : shape_t(tesselation_level) {
-        shapetype = CONE_SHAPE;
-    }
-
-    void generateGeometry() override {
-        vertices.clear();
-        colors.clear();
-        indices.clear();
-
-        unsigned int slices = 20 * level;
-        vertices.emplace_back(0, 1, 0, 1); // top
-        colors.emplace_back(1, 0, 0, 1);
-         // Center of base
-        vertices.emplace_back(0, -1, 0, 1);
-        colors.emplace_back(0, 0, 1, 1);  // blue
-
-        for (unsigned int i = 0; i <= slices; ++i) {
-            float theta = 2.0f * glm::pi<float>() * i / slices;
-            float x = cos(theta);
-            float z = sin(theta);
-            vertices.emplace_back(x, -1, z, 1);
-            colors.emplace_back(0, 1, 0, 1);
-        }
-
-        for (unsigned int i = 1; i <= slices; ++i) {
-            indices.push_back(0);
-            indices.push_back(i);
-            indices.push_back(i+1);
-        }for (unsigned int i = 0; i < slices; ++i) {
-            unsigned int apex = 0;
-            unsigned int v1 = 2 + i;
-            unsigned int v2 = 2 + (i + 1);
-
-            indices.push_back(apex);
-            indices.push_back(v1);
-            indices.push_back(v2);
-        }
+    cone_t(unsigned int tesselation_level = 2) : shape_t(CONE_SHAPE, tesselation_level) {}
+};
 
-        // Base (fan) 
-        for (unsigned int i = 0; i < slices; ++i) {
-            unsigned int center = 1;
-            unsigned int v1 = 2 + i;
-            unsigned int v2 = 2 + (i + 1);
+class box_t : public shape_t {
+public:
+    box_t(unsigned int tesselation_level = 1) : shape_t(BOX_SHAPE, tesselation_level) {}
+};
 
-            indices.push_back(center);
-            indices.push_back(v2);
-            indices.push_back(v1);
-    }
-}};
+// Cylinder
+class cylinder_t : public shape_t {
+public:
+    cylinder_t(unsigned int tesselation_level = 2) : shape_t(CYLINDER_SHAPE, tesselation_level) {}
+};
 
-class box_t : public shape_t {
+// Icosphere: each face of an icosahedron is split into a grid of
+// (2 * level)^2 triangles and pushed out onto the unit sphere. Its edges are
+// no longer than those of a UV sphere of the same level, with well under
+// half the triangles and vertices, and no fans of slivers at the poles.
+// The mesh has no table; it is generated on a builder thread.
+class icosphere_t : public shape_t {
 public:
-    box_t(unsigned int tesselation_level = 1) : shape_t(tesselation_level) {
-        shapetype = BOX_SHAPE;
-    }
+    icosphere_t(unsigned int tesselation_level = 1) : shape_t(ICOSPHERE_SHAPE, tesselation_level) {}
 
-    void generateGeometry() override {
+    static void generateGeometry(unsigned int level, mesh_t& mesh) {
+        auto& vertices = mesh.vertices;
+        auto& indices = mesh.indices;
         vertices.clear();
-        colors.clear();
         indices.clear();
 
-        unsigned int n = level; // tesselation subdivisions per edge
-        if (n < 1) n = 1;
-        auto addFace = [&](glm::vec3 origin, glm::vec3 uDir, glm::vec3 vDir) {
-            unsigned int startIndex = vertices.size();
-
-            for (unsigned int i = 0; i <= n; ++i) {
-                for (unsigned int j = 0; j <= n; ++j) {
-                    glm::vec3 pos = origin + uDir * (float(i)/n) * 2.0f + vDir * (float(j)/n) * 2.0f - (uDir+vDir); 
-                    vertices.emplace_back(pos, 1.0f);
-                    colors.emplace_back((pos.x+1)/2, (pos.y+1)/2, (pos.z+1)/2, 1.0f);
+        const double p = (1.0 + std::sqrt(5.0)) / 2.0;
+        static const double corners[12][3] = {
+            {-1, p, 0}, {1, p, 0}, {-1, -p, 0}, {1, -p, 0}, {0, -1, p}, {0, 1, p},
+            {0, -1, -p}, {0, 1, -p}, {p, 0, -1}, {p, 0, 1}, {-p, 0, -1}, {-p, 0, 1}};
+        static const unsigned int faces[20][3] = {
+            {0, 11, 5}, {0, 5, 1}, {0, 1, 7}, {0, 7, 10}, {0, 10, 11},
+            {1, 5, 9}, {5, 11, 4}, {11, 10, 2}, {10, 7, 6}, {7, 1, 8},
+            {3, 9, 4}, {3, 4, 2}, {3, 2, 6}, {3, 6, 8}, {3, 8, 9},
+            {4, 9, 5}, {2, 4, 11}, {6, 2, 10}, {8, 6, 7}, {9, 8, 1}};
+
+        unsigned int f = 2 * level; // segments per icosahedron edge
+        vertices.reserve(10 * f * f + 2);
+        indices.reserve(60 * f * f);
+
+        // A grid point is a weighted sum of up to three corners. Keyed by its
+        // (corner, weight) pairs in corner order, a point on an edge shared by
+        // two faces gets the same key, and the same position, from both.
+        std::unordered_map<uint32_t, unsigned int> index;
+        auto vertexAt = [&](const unsigned int* face, unsigned int i, unsigned int j) {
+            unsigned int weight[3] = {f - i - j, i, j};
+            unsigned int corner[3] = {face[0], face[1], face[2]};
+            for (int a = 0; a < 3; ++a) {
+                for (int b = a + 1; b < 3; ++b) {
+                    if (corner[b] < corner[a]) {
+                        std::swap(corner[a], corner[b]);
+                        std::swap(weight[a], weight[b]);
+                    }
                 }
             }
-
-            // Add indices
-            for (unsigned int i = 0; i < n; ++i) {
-                for (unsigned int j = 0; j < n; ++j) {
-                    unsigned int row1 = i * (n+1) + j + startIndex;
-                    unsigned int row2 = (i+1) * (n+1) + j + startIndex;
-
-                    // Triangle 1
-                    indices.push_back(row1);
-                    indices.push_back(row2);
-                    indices.push_back(row1 + 1);
-
-                    // Triangle 2
-                    indices.push_back(row2);
-                    indices.push_back(row2 + 1);
-                    indices.push_back(row1 + 1);
-                }
+            uint32_t key = 0;
+            double x = 0.0, y = 0.0, z = 0.0;
+            for (int a = 0; a < 3; ++a) {
+                if (weight[a] == 0) continue;
+                key = (key << 10) | (corner[a] << 5) | weight[a];
+                x += weight[a] * corners[corner[a]][0];
+                y += weight[a] * corners[corner[a]][1];
+                z += weight[a] * corners[corner[a]][2];
+            }
+            auto found = index.emplace(key, static_cast<unsigned int>(vertices.size()));
+            if (found.second) {
+                double length = std::sqrt(x * x + y * y + z * z);
+                vertices.emplace_back(x / length, y / length, z / length);
             }
+            return found.first->second;
         };
 
-        // Define 6 faces with origin, uDir, vDir
-        addFace(glm::vec3(-1,-1,-1), glm::vec3(2,0,0), glm::vec3(0,2,0)); // back
-        addFace(glm::vec3(-1,-1, 1), glm::vec3(2,0,0), glm::vec3(0,2,0)); // front
-        addFace(glm::vec3(-1,-1,-1), glm::vec3(0,0,2), glm::vec3(0,2,0)); // left
-        addFace(glm::vec3( 1,-1,-1), glm::vec3(0,0,2), glm::vec3(0,2,0)); // right
-        addFace(glm::vec3(-1, 1,-1), glm::vec3(2,0,0), glm::vec3(0,0,2)); // top
-        addFace(glm::vec3(-1,-1,-1), glm::vec3(2,0,0), glm::vec3(0,0,2)); // bottom
+        for (const auto& face : faces) {
+            for (unsigned int i = 0; i < f; ++i) {
+                for (unsigned int j = 0; i + j < f; ++j) {
+                    indices.push_back(vertexAt(face, i, j));
+                    indices.push_back(vertexAt(face, i + 1, j));
+                    indices.push_back(vertexAt(face, i, j + 1));
+                    if (i + j + 2 <= f) {
+                        indices.push_back(vertexAt(face, i + 1, j));
+                        indices.push_back(vertexAt(face, i + 1, j + 1));
+                        indices.push_back(vertexAt(face, i, j + 1));
+                    }
+                }
+            }
+        }
     }
 };
 
-// Cylinder
-class cylinder_t : public shape_t {
+// Process-wide cache of primitive meshes keyed by (type, tesselation level).
+// Entries are weak, so a mesh (and its GPU buffers) is released as soon as
+// the last shape using it goes away. New meshes are returned right away;
+// mesh_builder_t builds them if needed and queues them for upload.
+class mesh_cache_t {
 public:
-    cylinder_t(unsigned int tesselation_level = 2) : shape_t(tesselation_level) {
-        shapetype = CYLINDER_SHAPE;
+    static mesh_cache_t& instance() {
+        static mesh_cache_t cache;
+        return cache;
     }
 
-    void generateGeometry() override {
-        std::cout << "=== Cylinder generateGeometry() called ===" << std::endl;
-        vertices.clear();
-        colors.clear();
-        indices.clear();
+    std::shared_ptr<mesh_t> acquire(ShapeType type, unsigned int level) {
+        if (lodsReady) return lods[type][level - 1];
+        auto key = std::make_pair(type, level);
+        auto it = meshes.find(key);
+        if (it != meshes.end()) {
+            if (auto mesh = it->second.lock()) return mesh;
+        }
 
-        unsigned int slices = 20 * level;
-        std::cout << "Tesselation level: " << level << std::endl;
-        std::cout << "Slices: " << slices << std::endl;
-        
-        for (unsigned int i = 0; i <= slices; ++i) {
-            float theta = 2.0f * glm::pi<float>() * i / slices;
-            float x = cos(theta);
-            float z = sin(theta);
-            
-            vertices.emplace_back(x, 1, z, 1);   // Top vertex (even index)
-            colors.emplace_back(1, 0, 0, 1);     // Red
-            
-            vertices.emplace_back(x, -1, z, 1);  // Bottom vertex (odd index)  
-            colors.emplace_back(0, 0, 1, 1);     // Blue
-            
-            if (i % 10 == 0) { // Debug every 10th iteration
-                std::cout << "Iteration " << i << ": Added vertices at (" << x << ", 1, " << z << ") and (" << x << ", -1, " << z << ")" << std::endl;
-            }
+        auto mesh = std::make_shared<mesh_t>(type, level);
+        meshes[key] = mesh;
+        mesh_builder_t& builder = mesh_builder_t::instance();
+        if (findUnitMesh(type, level)) {
+            mesh->build(); // just a table lookup, not worth a worker
+            builder.submitBuilt(mesh);
+        } else {
+            builder.submit(mesh);
         }
-        
-        std::cout << "After vertex generation: " << vertices.size() << " vertices" << std::endl;
-        
-        // Fixed index generation
-        for (unsigned int i = 0; i < slices; ++i) {
-            unsigned int curr = i * 2;      // Curt pair start
-            unsigned int next = ((i + 1)%slices)* 2; // Next pair start
-            
-            // Triangle 1: curr_top, curr_bottom, next_top
-            indices.push_back(curr);        // Current top
-            indices.push_back(curr + 1);    // Current bottom
-            indices.push_back(next);        // Next top
-            
-            // Triangle 2: curr_bottom, next_bottom, next_top  
-            indices.push_back(curr + 1);    // Current bottom
-            indices.push_back(next + 1);    // Next bottom
-            indices.push_back(next);        // Next top
-            
-            if (i % 10 == 0) { // Debug every 10th iteration
-                std::cout << "Triangle pair " << i << ": indices (" << curr << "," << curr+1 << "," << next << ") and (" << curr+1 << "," << next+1 << "," << next << ")" << std::endl;
-            }
+        return mesh;
+    }
+
+    // Creates (or takes from the cache) every level 1-6 mesh of every
+    // primitive and keeps them alive, so switching levels never waits for a
+    // mesh. Afterwards acquire() is an array lookup.
+    void precomputeLods() {
+        if (lodsReady) return;
+        for (int t = 0; t < SHAPE_TYPE_COUNT; ++t) {
+            for (unsigned int l = 1; l <= 6; ++l) lods[t][l - 1] = acquire(static_cast<ShapeType>(t), l);
+        }
+        lodsReady = true;
+    }
+
+    // Strong references to every mesh currently alive
+    std::vector<std::shared_ptr<mesh_t>> liveMeshes() const {
+        std::vector<std::shared_ptr<mesh_t>> out;
+        for (const auto& entry : meshes) {
+            if (auto mesh = entry.second.lock()) out.push_back(std::move(mesh));
         }
-        
-        std::cout << "After index generation: " << indices.size() << " indices" << std::endl;
-        std::cout << "=== End generateGeometry() ===" << std::endl;
+        return out;
+    }
+
+    // Number of distinct meshes currently alive
+    size_t size() const {
+        size_t n = 0;
+        for (const auto& entry : meshes) if (!entry.second.expired()) ++n;
+        return n;
     }
+
+private:
+    std::map<std::pair<ShapeType, unsigned int>, std::weak_ptr<mesh_t>> meshes;
+    std::shared_ptr<mesh_t> lods[SHAPE_TYPE_COUNT][6];
+    bool lodsReady = false;
 };
+
+inline void mesh_t::build() {
+    table = findUnitMesh(type, level);
+    if (!table) {
+        if (type == ICOSPHERE_SHAPE) icosphere_t::generateGeometry(level, *this);
+        optimizeStats = optimizeMesh(vertices, indices);
+    }
+    compactIndices();
+    built.store(true, std::memory_order_release);
+}
+
+inline void shape_t::acquireMesh() {
+    mesh = mesh_cache_t::instance().acquire(shapetype, level);
+}
+
+inline void shape_t::selectLod(float lodValue, bool uploadedOnly) {
+    unsigned int current = lodLevel ? lodLevel : level;
+    if (lodLevel != 0 && lodValue < current + 1 + LOD_HYSTERESIS && lodValue >= current - LOD_HYSTERESIS) return;
+
+    float clamped = std::min(std::max(lodValue, 1.0f), 6.0f);
+    unsigned int l = static_cast<unsigned int>(clamped);
+    if (l != lodLevel) {
+        // Keep drawing the current mesh until the new level is on the GPU
+        std::shared_ptr<mesh_t> next = mesh_cache_t::instance().acquire(shapetype, l);
+        if (uploadedOnly && !next->isUploaded()) return;
+        lodLevel = l;
+        mesh = std::move(next);
+    }
+}
+
+inline void shape_t::resetLod() {
+    if (lodLevel == 0) return;
+    lodLevel = 0;
+    acquireMesh();
+}
+
+// Creates the shape class for a stored ShapeType
+inline std::unique_ptr<shape_t> makeShape(ShapeType type, unsigned int level) {
+    switch (type) {
+        case SPHERE_SHAPE: return std::make_unique<sphere_t>(level);
+        case CONE_SHAPE: return std::make_unique<cone_t>(level);
+        case BOX_SHAPE: return std::make_unique<box_t>(level);
+        case CYLINDER_SHAPE: return std::make_unique<cylinder_t>(level);
+        case ICOSPHERE_SHAPE: return std::make_unique<icosphere_t>(level);
+    }
+    return nullptr;
+}
 #endif // SHAPE_H
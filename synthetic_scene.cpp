@@ -0,0 +1,77 @@
+#include "synthetic_scene.h"
+#include <deque>
+#include <random>
+#include <sstream>
+#include <utility>
+
+void generateSyntheticModel(model_t& model, const synthetic_scene_t& params) {
+    model.clear();
+
+    std::mt19937 rng(params.seed);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::discrete_distribution<int> pickType(std::begin(params.mix), std::end(params.mix));
+
+    // (node id, depth) of nodes that may still get children
+    std::deque<std::pair<int, unsigned int>> open;
+    open.emplace_back(model.getNode(model.getRoot())->id, 0);
+
+    size_t added = 0;
+    while (added < params.nodes && !open.empty()) {
+        auto [parent, depth] = open.front();
+        open.pop_front();
+        if (depth >= params.depth) continue;
+
+        for (unsigned int k = 0; k < params.fanout && added < params.nodes; ++k, ++added) {
+            ShapeType type = static_cast<ShapeType>(pickType(rng));
+            model.addShapeToParent(parent, makeShape(type, params.level));
+
+            // Children sit around their parent and shrink with depth, so the
+            // whole scene stays inside the default view
+            node_handle_t h = model.getLastNode();
+            model_node_t* node = model.getNode(h);
+            glm::vec3 offset(unit(rng), unit(rng), unit(rng));
+            glm::vec3 axis(unit(rng), unit(rng), unit(rng));
+            if (glm::length(axis) < 1e-3f) axis = glm::vec3(0.0f, 1.0f, 0.0f);
+            node->translation = offset * (depth == 0 ? 2.5f : 1.2f);
+            node->rotation = glm::angleAxis(glm::radians(180.0f * unit(rng)), glm::normalize(axis));
+            node->scale = glm::vec3(depth == 0 ? 0.3f : 0.6f);
+            node->shape->setColor(glm::vec4(0.5f + 0.5f * unit(rng), 0.5f + 0.5f * unit(rng),
+                                            0.5f + 0.5f * unit(rng), 1.0f));
+            node->color = node->shape->color;
+            model.markDirty(h);
+
+            open.emplace_back(node->id, depth + 1);
+        }
+    }
+}
+
+bool parsePrimitiveMix(const std::string& text, unsigned int mix[SHAPE_TYPE_COUNT]) {
+    unsigned int parsed[SHAPE_TYPE_COUNT] = {};
+
+    std::stringstream ss(text);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        size_t colon = item.find(':');
+        std::string name = item.substr(0, colon);
+        unsigned int weight = 1;
+        if (colon != std::string::npos) {
+            try {
+                weight = static_cast<unsigned int>(std::stoul(item.substr(colon + 1)));
+            } catch (...) {
+                return false;
+            }
+        }
+        int type = -1;
+        for (int t = 0; t < SHAPE_TYPE_COUNT; ++t) {
+            if (name == shapeTypeName(t)) type = t;
+        }
+        if (type < 0) return false;
+        parsed[type] = weight;
+    }
+    unsigned int total = 0;
+    for (int t = 0; t < SHAPE_TYPE_COUNT; ++t) total += parsed[t];
+    if (total == 0) return false;
+
+    for (int t = 0; t < SHAPE_TYPE_COUNT; ++t) mix[t] = parsed[t];
+    return true;
+}
@@ -0,0 +1,26 @@
+#ifndef SYNTHETIC_SCENE_H
+#define SYNTHETIC_SCENE_H
+
+#include <string>
+#include "HIERARCHIAL.h"
+
+// Parameters for generateSyntheticModel(). The same seed always produces the
+// same hierarchy, so runs of the benchmarks can be compared.
+struct synthetic_scene_t {
+    size_t nodes = 10000;         // shapes below the root
+    unsigned int depth = 6;       // deepest level below the root
+    unsigned int fanout = 8;      // children per node
+    unsigned int level = 2;       // tesselation level of every shape
+    unsigned int mix[SHAPE_TYPE_COUNT] = {1, 1, 1, 1, 0}; // relative weight of each ShapeType
+    unsigned int seed = 1;
+};
+
+// Replaces the contents of model with a breadth-first filled hierarchy of
+// small, randomly placed shapes. Stops early when depth and fanout cannot
+// hold params.nodes shapes.
+void generateSyntheticModel(model_t& model, const synthetic_scene_t& params);
+
+// Parses a primitive mix such as "sphere:4,box:1" (unlisted types get 0)
+bool parsePrimitiveMix(const std::string& text, unsigned int mix[SHAPE_TYPE_COUNT]);
+
+#endif
@@ -0,0 +1,104 @@
+#include "task_pool.h"
+#include <algorithm>
+
+// The render thread is the extra thread of every run()
+task_pool_t& task_pool_t::instance() {
+    static task_pool_t pool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+    return pool;
+}
+
+task_pool_t::task_pool_t(unsigned int workerCount) {
+    for (unsigned int k = 0; k <= workerCount; ++k) queues.push_back(std::make_unique<queue_t>());
+    for (unsigned int k = 0; k < workerCount; ++k) workers.emplace_back(&task_pool_t::workerLoop, this, k);
+}
+
+task_pool_t::~task_pool_t() {
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& w : workers) w.join();
+}
+
+void task_pool_t::run(size_t count, const std::function<void(size_t)>& task) {
+    if (count == 0) return;
+    if (workers.empty() || count == 1) {
+        for (size_t k = 0; k < count; ++k) task(k);
+        return;
+    }
+
+    std::lock_guard<std::mutex> runLock(runMutex);
+    current = &task;
+    remaining.store(count, std::memory_order_relaxed);
+    // Neighbouring tasks usually touch neighbouring memory, so each thread
+    // starts on one contiguous block
+    for (size_t q = 0; q < queues.size(); ++q) {
+        std::lock_guard<std::mutex> lock(queues[q]->mutex);
+        for (size_t k = count * q / queues.size(); k < count * (q + 1) / queues.size(); ++k) {
+            queues[q]->tasks.push_back(k);
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        ++generation;
+    }
+    wake.notify_all();
+
+    size_t index;
+    while (takeTask(queues.size() - 1, index)) {
+        task(index);
+        finishTask();
+    }
+    std::unique_lock<std::mutex> lock(stateMutex);
+    done.wait(lock, [this] { return remaining.load(std::memory_order_acquire) == 0; });
+}
+
+void task_pool_t::workerLoop(size_t self) {
+    uint64_t seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(stateMutex);
+            wake.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping) return;
+            seen = generation;
+        }
+        // current is only read after taking a task, and run() cannot replace
+        // it before that task has finished
+        size_t index;
+        while (takeTask(self, index)) {
+            (*current)(index);
+            finishTask();
+        }
+    }
+}
+
+// Own queue from the front, then the other queues from the back
+bool task_pool_t::takeTask(size_t self, size_t& index) {
+    {
+        queue_t& own = *queues[self];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            index = own.tasks.front();
+            own.tasks.pop_front();
+            return true;
+        }
+    }
+    for (size_t k = 1; k < queues.size(); ++k) {
+        queue_t& victim = *queues[(self + k) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            index = victim.tasks.back();
+            victim.tasks.pop_back();
+            return true;
+        }
+    }
+    return false;
+}
+
+void task_pool_t::finishTask() {
+    if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        done.notify_all();
+    }
+}
@@ -0,0 +1,61 @@
+#ifndef TASK_POOL_H
+#define TASK_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fork-join pool for spreading one frame's CPU work (the scene update in
+// model_t) over every core. run() deals the tasks out to one deque per
+// thread in contiguous blocks; each thread works through its own block
+// from the front and, once that is empty, steals from the back of the
+// others', so unevenly sized tasks still keep every core busy. The calling
+// thread takes a share too, so without workers (one core) run() is a plain
+// loop.
+class task_pool_t {
+public:
+    static task_pool_t& instance();
+    explicit task_pool_t(unsigned int workerCount);
+    ~task_pool_t();
+
+    task_pool_t(const task_pool_t&) = delete;
+    task_pool_t& operator=(const task_pool_t&) = delete;
+
+    // Calls task(k) for every k in [0, count) and returns once all calls
+    // have finished. Calls run concurrently and in no particular order;
+    // concurrent run() calls take turns.
+    void run(size_t count, const std::function<void(size_t)>& task);
+    // Workers plus the calling thread
+    unsigned int threadCount() const { return static_cast<unsigned int>(workers.size()) + 1; }
+
+private:
+    struct queue_t {
+        std::mutex mutex;
+        std::deque<size_t> tasks;
+    };
+
+    void workerLoop(size_t self);
+    bool takeTask(size_t self, size_t& index);
+    void finishTask();
+
+    std::vector<std::unique_ptr<queue_t>> queues; // one per worker, the caller's last
+    const std::function<void(size_t)>* current = nullptr;
+    std::atomic<size_t> remaining{0};
+
+    std::mutex runMutex;
+    std::mutex stateMutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    uint64_t generation = 0; // bumped by every run()
+    bool stopping = false;
+    std::vector<std::thread> workers;
+};
+
+#endif